@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <sys/stat.h>
+
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "File.hpp"
+
+#if defined(_POSIX_VERSION)
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+// the assets preprocessed by assetpack into one file: models imported,
+// packed and reordered, images decoded with their mip chains and shader
+// sources. the file is mapped and uploaded from as it is. the loaders look
+// here first and fall back to the sources for whatever the pack doesn't have
+struct AssetPack {
+  static constexpr char MAGIC[8] = {'M', 'F', 'P', 'A', 'C', 'K', '\0', '\0'};
+  static constexpr uint32_t VERSION = 1;
+  // blobs start at multiples of this
+  static constexpr size_t ALIGN = 16;
+
+  enum class Type : uint32_t {
+    SHADER,
+    TEXTURE,
+    MODEL
+  };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t no_entries;
+    uint64_t index_offset;
+  };
+
+  // the index, sorted by name. names are relative to the directory the pack
+  // was made from and is loaded next to. a shader blob is the source text
+  // without a terminating zero, offsets inside the other blobs are from
+  // their start
+  struct Entry {
+    char name[112];
+    Type type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  // followed by no_levels TextureLevel, largest first, rows tightly packed
+  struct TextureHeader {
+    uint32_t width, height;
+    // img::Image::Format
+    uint32_t format;
+    uint32_t no_levels;
+  };
+
+  struct TextureLevel {
+    uint32_t width, height;
+    uint64_t offset, size;
+  };
+
+  struct ModelHeader {
+    uint32_t no_meshes;
+    uint32_t reserved;
+    uint64_t meshes_offset;
+  };
+
+  // vertices are PackedVertex, indices index_size bytes each
+  struct MeshHeader {
+    uint32_t no_vertices, no_indices;
+    uint32_t index_size;
+    uint32_t no_textures;
+    uint64_t vertices_offset, indices_offset, textures_offset;
+  };
+
+  // path is relative to the directory of the model
+  struct MeshTexture {
+    char type[32];
+    char path[96];
+  };
+
+  static inline std::string root = "";
+  static inline const uint8_t *base = nullptr;
+  static inline size_t length = 0;
+  static inline time_t mtime = 0;
+#if !defined(_POSIX_VERSION)
+  static inline std::vector<uint8_t> contents;
+#endif
+
+  static std::string relative(const std::string &dir, const std::string &filename) {
+    if(dir.empty() || filename.compare(0, dir.length(), dir) != 0) {
+      return filename;
+    }
+    size_t start = dir.length();
+    while(start < filename.length() && filename[start] == sys::Path::separator)++start;
+    return filename.substr(start);
+  }
+
+  static time_t modification_time(const std::string &filename) {
+    struct stat st;
+    if(stat(filename.c_str(), &st) != 0)return 0;
+    return st.st_mtime;
+  }
+
+  static const Header *header() {
+    return (const Header *)base;
+  }
+
+  static const Entry *entries() {
+    return (const Entry *)(base + header()->index_offset);
+  }
+
+  // looks for dir/filename, false if there is no usable pack
+  static bool open(const std::string &dir, const std::string &filename="assets.pack"s) {
+    close();
+    const std::string path = sys::Path(dir) / sys::Path(filename);
+#if defined(_POSIX_VERSION)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+      LOG(INFO, GRAPHICS, "asset pack: no '%s', loading from the sources\n", path.c_str());
+      return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    length = st.st_size;
+    void *ptr = length >= sizeof(Header) ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if(ptr == MAP_FAILED) {
+      LOG(ERROR, GRAPHICS, "asset pack: unable to map '%s'\n", path.c_str());
+      length = 0;
+      return false;
+    }
+    base = (const uint8_t *)ptr;
+    mtime = st.st_mtime;
+#else
+    std::ifstream in(path, std::ifstream::binary);
+    if(!in) {
+      LOG(INFO, GRAPHICS, "asset pack: no '%s', loading from the sources\n", path.c_str());
+      return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    base = contents.data();
+    length = contents.size();
+    mtime = modification_time(path);
+#endif
+    if(length < sizeof(Header) || memcmp(header()->magic, MAGIC, sizeof(MAGIC)) != 0 || header()->version != VERSION
+       || header()->index_offset + header()->no_entries * sizeof(Entry) > length)
+    {
+      LOG(ERROR, GRAPHICS, "asset pack: '%s' is not a version %u pack, ignoring it\n", path.c_str(), VERSION);
+      close();
+      return false;
+    }
+    root = dir;
+    LOG(INFO, GRAPHICS, "asset pack: mapped '%s', %u entries, %lu bytes\n", path.c_str(), header()->no_entries, length);
+    return true;
+  }
+
+  // nullptr if the pack has no such asset or the source is newer than it
+  static const Entry *find(const std::string &filename, Type type) {
+    if(base == nullptr)return nullptr;
+    const std::string name = relative(root, filename);
+    const Entry *begin = entries(), *end = begin + header()->no_entries;
+    const Entry *e = std::lower_bound(begin, end, name, [](const Entry &a, const std::string &b) -> bool {
+      return strncmp(a.name, b.c_str(), sizeof(a.name)) < 0;
+    });
+    if(e == end || strncmp(e->name, name.c_str(), sizeof(e->name)) != 0 || e->type != type) {
+      return nullptr;
+    }
+    if(modification_time(filename) > mtime) {
+      LOG(WARNING, GRAPHICS, "asset pack: '%s' changed since the pack was made, loading the source\n", name.c_str());
+      return nullptr;
+    }
+    return e;
+  }
+
+  template <typename T>
+  static const T *at(const Entry *e, uint64_t offset=0) {
+    ASSERT(e->offset + offset <= length);
+    return (const T *)(base + e->offset + offset);
+  }
+
+  static void close() {
+    if(base == nullptr)return;
+#if defined(_POSIX_VERSION)
+    munmap((void *)base, length);
+#else
+    contents.clear();
+#endif
+    base = nullptr;
+    length = 0;
+    root = "";
+  }
+};
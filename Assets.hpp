@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <list>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "Loader.hpp"
+
+// assets shared by everything that draws with them: models, textures and
+// fonts are made once per key, the file they come from, however many objects
+// ask for them, and handles count the users. an asset nobody uses any more
+// stays initialized in case it is asked for again, e.g. by the next game,
+// until more than max_unused of its type are waiting and the least recently
+// released one is cleared. an asset can also be made by the Loader, in
+// which case it has load(), the part that may run on a worker, and upload(),
+// a slice of the GL part that returns true when it is done
+namespace asset {
+
+// what every registry still keeps, cleared by asset::clear()
+inline std::vector<void (*)()> registries;
+
+template <typename T>
+struct Entry {
+  std::string key;
+  T object;
+  int no_users = 0;
+  bool initialized = false;
+  // given to the loader, it isn't erased before it is back
+  bool loading = false;
+
+  template <typename... Args>
+  Entry(const std::string &key, Args&&... args):
+    key(key), object(std::forward<Args>(args)...)
+  {}
+};
+
+template <typename T> struct Registry;
+
+// one user of an asset. init() makes the asset if nobody has, load_async()
+// has the loader make it, clear() gives it back. ready() tells whether it
+// can be drawn with yet
+template <typename T>
+struct Handle {
+  Entry<T> *entry = nullptr;
+
+  Handle()
+  {}
+
+  explicit Handle(Entry<T> *entry):
+    entry(entry)
+  {}
+
+  // a copy would be a user the count doesn't know of
+  Handle(const Handle &other) = delete;
+  Handle &operator=(const Handle &other) = delete;
+
+  Handle(Handle &&other):
+    entry(other.entry)
+  {
+    other.entry = nullptr;
+  }
+
+  // the entry held so far loses its user, other's moves over
+  Handle &operator=(Handle &&other) {
+    if(this != &other) {
+      clear();
+      entry = other.entry;
+      other.entry = nullptr;
+    }
+    return *this;
+  }
+
+  bool valid() const {
+    return entry != nullptr;
+  }
+
+  bool ready() const {
+    return entry != nullptr && entry->initialized;
+  }
+
+  const std::string &key() const {
+    ASSERT(entry != nullptr);
+    return entry->key;
+  }
+
+  T &operator*() {
+    ASSERT(entry != nullptr);
+    return entry->object;
+  }
+
+  T *operator->() {
+    ASSERT(entry != nullptr);
+    return &entry->object;
+  }
+
+  void init() {
+    ASSERT(entry != nullptr);
+    ASSERT(!entry->loading);
+    if(!entry->initialized) {
+      entry->object.init();
+      entry->initialized = true;
+      ++Registry<T>::no_loaded;
+    }
+  }
+
+  void load_async() {
+    ASSERT(entry != nullptr);
+    if(entry->initialized || entry->loading)return;
+    entry->loading = true;
+    Entry<T> *e = entry;
+    Loader::load([e]() -> void {
+      e->object.load();
+    }, [e]() -> bool {
+      if(!e->object.upload())return false;
+      Registry<T>::loaded(e);
+      return true;
+    });
+  }
+
+  void clear() {
+    if(entry == nullptr)return;
+    Registry<T>::release(entry);
+    entry = nullptr;
+  }
+};
+
+template <typename T>
+struct Registry {
+  static inline std::unordered_map<std::string, std::unique_ptr<Entry<T>>> entries;
+  // released and still initialized, least recently released first
+  static inline std::list<Entry<T> *> unused;
+  static inline size_t max_unused = 8;
+  static inline bool registered = false;
+
+  static inline uint64_t no_loaded = 0;
+  static inline uint64_t no_shared = 0;
+  static inline uint64_t no_evicted = 0;
+
+  // the asset under key, constructed from args if there is none
+  template <typename... Args>
+  static Handle<T> acquire(const std::string &key, Args&&... args) {
+    if(!registered) {
+      registries.push_back(clear_unused);
+      registered = true;
+    }
+    auto it = entries.find(key);
+    if(it == entries.end()) {
+      it = entries.emplace(key, std::make_unique<Entry<T>>(key, std::forward<Args>(args)...)).first;
+    } else if(it->second->initialized) {
+      ++no_shared;
+    }
+    Entry<T> *e = it->second.get();
+    if(e->no_users++ == 0) {
+      unused.remove(e);
+    }
+    return Handle<T>(e);
+  }
+
+  // for the assets made from nothing but their file
+  static Handle<T> load(const std::string &filename) {
+    return acquire(filename, filename);
+  }
+
+  static void release(Entry<T> *e) {
+    ASSERT(e->no_users > 0);
+    if(--e->no_users > 0)return;
+    if(e->loading)return;
+    if(!e->initialized) {
+      const std::string key = e->key;
+      entries.erase(key);
+      return;
+    }
+    unused.push_back(e);
+    while(unused.size() > max_unused) {
+      evict(unused.front());
+    }
+  }
+
+  // back from the loader, the users it had then may be gone
+  static void loaded(Entry<T> *e) {
+    e->loading = false;
+    e->initialized = true;
+    ++no_loaded;
+    if(e->no_users == 0) {
+      ++e->no_users;
+      release(e);
+    }
+  }
+
+  static void evict(Entry<T> *e) {
+    ASSERT(e->no_users == 0);
+    unused.remove(e);
+    // a load the loader dropped may have uploaded a part
+    LOG(INFO, GRAPHICS, "assets: evicting '%s'\n", e->key.c_str());
+    e->object.clear();
+    ++no_evicted;
+    const std::string key = e->key;
+    entries.erase(key);
+  }
+
+  static void clear_unused() {
+    while(!unused.empty()) {
+      evict(unused.front());
+    }
+    std::vector<Entry<T> *> left;
+    for(const auto &it : entries) {
+      if(it.second->no_users == 0) {
+        left.push_back(it.second.get());
+      } else {
+        LOG(WARNING, GRAPHICS, "assets: '%s' still has %d users\n", it.first.c_str(), it.second->no_users);
+      }
+    }
+    for(Entry<T> *e : left) {
+      evict(e);
+    }
+  }
+};
+
+// at shutdown, with the context still current and the loader stopped
+inline void clear() {
+  for(auto &clear_unused : registries) {
+    clear_unused();
+  }
+}
+
+} // namespace asset
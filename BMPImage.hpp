@@ -50,11 +50,11 @@ struct BMPImage : public Image {
     format = Image::Format::RGB;
     // Some BMP files are misformatted, guess missing information
     if(img_size == 0 || img_size != width * height * bpp) {
-      Logger::Warning("[bmp] warning: file [%s] has incorrect img_size %d\n", filename.c_str(), img_size);
+      LOG(WARNING, GRAPHICS, "[bmp] warning: file [%s] has incorrect img_size %d\n", filename.c_str(), img_size);
       img_size = width * height * bpp;
     }
     if(data_pos != 138) {
-      Logger::Warning("[bmp] warning: file [%s] has incorrect data_pos %d\n", filename.c_str(), data_pos);
+      LOG(WARNING, GRAPHICS, "[bmp] warning: file [%s] has incorrect data_pos %d\n", filename.c_str(), data_pos);
       data_pos = 138;
     }
     ASSERT(img_size == width * height * bpp);
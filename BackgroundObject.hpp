@@ -7,7 +7,9 @@
 #include "ShaderBuffer.hpp"
 #include "ShaderAttrib.hpp"
 #include "Texture.hpp"
+#include "RenderQueue.hpp"
 #include "Tuple.hpp"
+#include "Trace.hpp"
 
 struct BackgroundObject {
   gl::ShaderProgram<
@@ -50,14 +52,14 @@ struct BackgroundObject {
     ShaderProgram::init(program, vao);
   }
 
-  void display(Camera &cam) {
-    ShaderProgram::use(program);
-
-    VertexArray::bind(vao);
-    VertexArray::draw<GL_TRIANGLES>(vao);
-    VertexArray::unbind();
-
-    ShaderProgram::unuse();
+  void submit(gl::RenderQueue &queue, Camera &cam) {
+    TRACE_SCOPE("BackgroundObject: submit");
+    gl::RenderQueue::Packet &p = queue.add(gl::RenderQueue::Pass::BACKGROUND);
+    p.program = program.id();
+    p.vertex_array = vao.id();
+    p.draw = [this]() mutable -> void {
+      VertexArray::draw<GL_TRIANGLES>(vao);
+    };
   }
 
   void clear() {
@@ -4,6 +4,7 @@
 #include <array>
 
 #include "Timer.hpp"
+#include "Scheduler.hpp"
 #include "Unit.hpp"
 
 struct Player;
@@ -11,9 +12,15 @@ struct Player;
 struct Ball {
   Unit unit;
   Timer timer;
-  static constexpr int
-    TIME_LOOSE_BALL_BEGINS = 0,
-    TIME_ABLE_TO_INTERACT = 1;
+  enum Event : Scheduler::key_t {
+    LOOSE_BALL_ENDS,
+    INTERACTION_UNLOCKED,
+    NO_EVENTS
+  };
+  Scheduler *scheduler = nullptr;
+  Scheduler::key_t first_key = 0;
+  bool loose = false;
+  bool interaction_locked = false;
   const float loose_ball_cooldown = 0.1;
   static constexpr Timer::time_t CANT_INTERACT_SHOT = .7;
   static constexpr Timer::time_t CANT_INTERACT_SLIDE = .45;
@@ -37,9 +44,24 @@ struct Ball {
     reset_height();
   }
 
-  void set_timer() {
+  void set_timer(Scheduler &sched, Scheduler::key_t key) {
     reset_height();
-    timer.set_timeout(TIME_LOOSE_BALL_BEGINS, loose_ball_cooldown);
+    scheduler = &sched;
+    first_key = key;
+    loose = true;
+    schedule(LOOSE_BALL_ENDS, loose_ball_cooldown);
+  }
+
+  void schedule(Event event, Timer::time_t delay) {
+    scheduler->schedule_in(first_key + event, delay);
+  }
+
+  void on_event(Event event) {
+    switch(event) {
+      case LOOSE_BALL_ENDS: loose = false; break;
+      case INTERACTION_UNLOCKED: interaction_locked = false; break;
+      case NO_EVENTS:break;
+    }
   }
 
   Unit::vec_t &position() { return unit.pos; }
@@ -91,14 +113,15 @@ struct Ball {
   }
 
   void face(Unit::loc_t point) {
-    unit.facing_dest = atan2(point.y - unit.pos.y, point.x - unit.pos.x);
+    unit.facing_dest = det::atan2(point.y - unit.pos.y, point.x - unit.pos.x);
   }
 
   void timestamp_set_owner(int new_owner) {
     if(current_owner == new_owner)return;
     current_owner = new_owner;
     if(current_owner != -1) {
-      timer.set_event(TIME_LOOSE_BALL_BEGINS);
+      loose = true;
+      schedule(LOOSE_BALL_ENDS, loose_ball_cooldown);
       last_touched = current_owner;
     }
   }
@@ -108,15 +131,15 @@ struct Ball {
   }
 
   bool is_loose() const {
-    return owner() != NO_OWNER && !timer.timed_out(TIME_LOOSE_BALL_BEGINS);
+    return owner() != NO_OWNER && loose;
   }
 
   void disable_interaction(Timer::time_t lock_for=CANT_INTERACT_SHOT) {
-    timer.set_event(TIME_ABLE_TO_INTERACT);
-    timer.set_timeout(TIME_ABLE_TO_INTERACT, lock_for);
+    interaction_locked = true;
+    schedule(INTERACTION_UNLOCKED, lock_for);
   }
 
   bool can_interact() const {
-    return timer.timed_out(TIME_ABLE_TO_INTERACT);
+    return !interaction_locked;
   }
 };
@@ -8,6 +8,8 @@
 #include "Camera.hpp"
 #include "Model.hpp"
 #include "Shadow.hpp"
+#include "RenderQueue.hpp"
+#include "Trace.hpp"
 
 struct BallObject {
   std::string dir;
@@ -18,6 +20,7 @@ struct BallObject {
 
   Transformation transform;
   glm::mat4 matrix;
+  glm::vec3 color;
 
   gl::ShaderProgram<
     gl::VertexShader,
@@ -142,7 +145,7 @@ struct BallObject {
     vao.set_divisor(attrTexcoord, 0);
 
     ShaderProgram::init(program, vao);
-    ballTx.init(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ball.png"s));
+    ballTx.init_async(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ball.png"s));
 
     ballTx.uSampler.set_id(program.id());
     uTransform.set_id(program.id());
@@ -151,7 +154,8 @@ struct BallObject {
     shadow.init();
   }
 
-  void display(const Ball &ball, Camera &cam) {
+  void submit(gl::RenderQueue &queue, const Ball &ball, Camera &cam) {
+    TRACE_SCOPE("BallObject: submit");
     transform.SetPosition(ball.unit.pos.x, ball.unit.pos.y, ball.unit.pos.z);
     float angle = ball.unit.facing_dest;
     glm::vec2 dir(std::cos(angle), std::sin(angle));
@@ -161,38 +165,34 @@ struct BallObject {
     transform.SetRotation(0, 0, M_PI/2, deg);
 
     shadow.transform.SetPosition(ball.unit.pos.x, ball.unit.pos.y, .001);
-    shadow.display(cam);
-
-    ShaderProgram::use(program);
-
-    if(transform.has_changed || cam.has_changed) {
-      matrix = cam.get_matrix() * transform.get_matrix();
-      uTransform.set_data(matrix);
+    shadow.submit(queue, cam);
 
+    if(transform.has_changed) {
+      matrix = transform.get_matrix();
       transform.has_changed = false;
     }
 
-    {
-      glm::vec3 color(1, 1, 1);
-      if(ball.owner() != Ball::NO_OWNER) {
-        color.x = .8;
-      }
-      if(ball.is_in_air) {
-        color.y = .8;
-      }
-      uColor.set_data(color);
+    color = glm::vec3(1, 1, 1);
+    if(ball.owner() != Ball::NO_OWNER) {
+      color.x = .8;
+    }
+    if(ball.is_in_air) {
+      color.y = .8;
     }
 
-    gl::Texture::set_active(0);
-    ballTx.bind();
-    ballTx.set_data(0);
-
-    VertexArray::bind(vao);
-    VertexArray::draw<GL_TRIANGLES>(vao, 0, SIZE * 3);
-    VertexArray::unbind();
-
-    gl::Texture::unbind();
-    ShaderProgram::unuse();
+    // the camera comes from the frame uniforms
+    gl::RenderQueue::Packet &p = queue.add(gl::RenderQueue::Pass::OPAQUE);
+    p.program = program.id();
+    p.add_texture(ballTx.id());
+    p.vertex_array = vao.id();
+    p.depth = queue.distance(glm::vec3(matrix[3]));
+    p.transform_location = uTransform.id();
+    p.transform = matrix;
+    p.draw = [this]() mutable -> void {
+      uColor.set_data(color);
+      ballTx.set_data(0);
+      VertexArray::draw<GL_TRIANGLES>(vao, 0, SIZE * 3);
+    };
   }
 
   void clear() {
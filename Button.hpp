@@ -6,7 +6,7 @@
 #include "Transformation.hpp"
 #include "Region.hpp"
 #include "Camera.hpp"
-#include "Sprite.hpp"
+#include "Assets.hpp"
 #include "ShaderProgram.hpp"
 #include "Shader.hpp"
 #include "ShaderUniform.hpp"
@@ -27,7 +27,7 @@ struct Button {
   const std::string btntextf = sys::Path("shaders"s) / sys::Path("btn_text.frag"s);
 
   using self_t = Button<BUTTON_FILENAME, FONT_FILENAME>;
-  Sprite<ui::Font, self_t> *font;
+  asset::Handle<ui::Font> font;
   ui::Text label;
   gl::Texture btnTx;
   static constexpr int DEFAULT_STATE = 0;
@@ -57,8 +57,8 @@ struct Button {
 
   Button(const std::string &dir, Region region=Region(glm::vec2(-1,1), glm::vec2(-1,1))):
     dir(dir),
-    font(Sprite<ui::Font, self_t>::create(sys::Path(dir) / sys::Path(FONT_FILENAME::c_str))),
-    label(font->object),
+    font(asset::Registry<ui::Font>::load(sys::Path(dir) / sys::Path(FONT_FILENAME::c_str))),
+    label(*font),
     btnTx("btn"),
     uState("state"),
     quadProgram({
@@ -88,9 +88,9 @@ struct Button {
 
     ShaderProgramQuad::init(quadProgram, vao);
 
-    font->init();
+    font.init();
     label.init(textProgram);
-    btnTx.init(sys::Path(dir) / sys::Path(BUTTON_FILENAME::c_str));
+    btnTx.init_async(sys::Path(dir) / sys::Path(BUTTON_FILENAME::c_str));
     btnTx.uSampler.set_id(quadProgram.id());
     uState.set_id(quadProgram.id());
   }
@@ -149,6 +149,11 @@ struct Button {
   }
 
   void display() {
+    display(label);
+  }
+
+  // the button with another label, e.g. one kept per list entry
+  void display(ui::Text &label) {
     label.transform.SetScale((region.x2()-region.x1())/2, (region.y2()-region.y1())/2, 1.);
     label.pos = { region.center().x, region.center().y };
 
@@ -186,7 +191,7 @@ struct Button {
     label.clear();
     ShaderProgramQuad::clear(quadProgram);
     ShaderProgramText::clear(textProgram);
-    font->clear();
+    font.clear();
   }
 };
 
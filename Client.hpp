@@ -32,7 +32,7 @@ struct Client {
   void start_mclient() {
     ASSERT(!is_active_mclient());
     mclient.start();
-    Logger::Info("started mclient\n");
+    LOG(INFO, GENERAL, "started mclient\n");
   }
   void stop_mclient() {
     ASSERT(is_active_mclient());
@@ -76,35 +76,35 @@ struct Client {
 
 // actions
   void action_quit() {
-    Logger::Info("client: action quit\n");
+    LOG(INFO, GENERAL, "client: action quit\n");
     state = State::QUIT;
   }
   void action_host_game() {
-    Logger::Info("client: action host game\n");
+    LOG(INFO, GENERAL, "client: action host game\n");
     stop_mclient();
     start_lobby();
   }
   void action_join_game() {
-    Logger::Info("client: action join game\n");
+    LOG(INFO, GENERAL, "client: action join game\n");
     stop_mclient();
     start_lobby();
   }
 
   void action_start_game() {
-    Logger::Info("client: action start game\n");
+    LOG(INFO, GENERAL, "client: action start game\n");
     start_game();
     stop_lobby();
     intelligence->start();
   }
 
   void action_quit_lobby() {
-    Logger::Info("client: action quit lobby\n");
+    LOG(INFO, GENERAL, "client: action quit lobby\n");
     stop_lobby();
     start_mclient();
   }
 
   void action_quit_game() {
-    Logger::Info("client: action leave game\n");
+    LOG(INFO, GENERAL, "client: action leave game\n");
     stop_game();
     start_mclient();
     mclient.set_state(MetaServerClient::State::DEFAULT);
@@ -112,7 +112,7 @@ struct Client {
 
   // scope functions
   void start() {
-    Logger::Info("client: start\n");
+    LOG(INFO, GENERAL, "client: start\n");
     state = State::DEFAULT;
     start_mclient();
   }
@@ -126,6 +126,6 @@ struct Client {
     if(is_active_mclient()) {
       mclient.stop();
     }
-    Logger::Info("client: stopped\n");
+    LOG(INFO, GENERAL, "client: stopped\n");
   }
 };
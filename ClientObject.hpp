@@ -4,7 +4,9 @@
 #include "LobbyObject.hpp"
 #include "MetaServerObject.hpp"
 #include "CursorObject.hpp"
+#include "ProfilerObject.hpp"
 #include "Client.hpp"
+#include "Trace.hpp"
 
 struct ClientObject {
   ui::CursorObject cursor;
@@ -16,22 +18,35 @@ struct ClientObject {
   LobbyObject lObject;
   MetaServerObject mObject;
 
+  FrameProfiler profiler;
+  ProfilerObject profilerObj;
+
   ClientObject(Client &client, const std::string &dir):
     cursor(dir),
     client(client), dir(dir),
     mObject(client.mclient, dir),
-    lObject(dir)
+    lObject(dir),
+    profilerObj(dir)
   {}
 
   void init() {
-    Logger::Info("cobject: initialized\n");
+    LOG(INFO, GRAPHICS, "cobject: initialized\n");
     mObject.init();
     lObject.init();
     gObject = nullptr; // need to set/unset actors!
     cursor.init();
+    profiler.init();
+    profilerObj.init();
   }
 
   void keypress(int key, int mods) {
+    if(key == GLFW_KEY_F3) {
+      profilerObj.toggle();
+      return;
+    } else if(key == GLFW_KEY_F4) {
+      profiler.dump_csv(sys::Path(dir) / sys::Path("frametimes.csv"s));
+      return;
+    }
     if(gObject != nullptr) {
       gObject->keypress(key, mods);
     }
@@ -89,7 +104,7 @@ struct ClientObject {
     lObject.lobbyActor = client.l_actor;
     // set gObject
     if(gObject == nullptr && client.is_active_game()) {
-      gObject = new GameObject(*client.soccer, *client.intelligence, cursor, dir);
+      gObject = new GameObject(*client.soccer, *client.intelligence, cursor, profiler, dir);
       gObject->init();
     } else if(gObject != nullptr && !client.is_active_game()) {
       gObject->clear();
@@ -100,25 +115,43 @@ struct ClientObject {
   }
 
   void display(GLFWwindow *window, size_t wgt, size_t hgt) {
-    update_states();
+    TRACE_SCOPE("ClientObject: display");
+    {
+      auto phase = profiler.scope(FrameProfiler::UPDATE);
+      update_states();
+    }
     if(mObject.is_active()) {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_MENU);
       mObject.display();
     } else if(lObject.is_active()) {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_MENU);
       lObject.display();
     } else if(client.is_active_game()) {
-      gObject->set_winsize(wgt, hgt);
-      gObject->keyboard(window);
-      gObject->idle();
-      gObject->current_time += 1./60;
+      {
+        auto phase = profiler.scope(FrameProfiler::IDLE);
+        gObject->set_winsize(wgt, hgt);
+        gObject->keyboard(window);
+        gObject->idle();
+        gObject->current_time += 1./60;
+      }
       gObject->display();
     }
-    cursor.display();
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_CURSOR);
+      cursor.display();
+    }
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_HUD);
+      profilerObj.display(profiler);
+    }
   }
 
   void clear() {
-    Logger::Info("cobject: clearance\n");
+    LOG(INFO, GRAPHICS, "cobject: clearance\n");
     mObject.clear();
     lObject.clear();
+    profilerObj.clear();
+    profiler.clear();
     if(gObject != nullptr) {
       gObject->clear();
       delete gObject;
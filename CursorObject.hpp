@@ -7,6 +7,7 @@
 #include "Texture.hpp"
 #include "Timer.hpp"
 #include "Region.hpp"
+#include "Trace.hpp"
 
 namespace ui {
 struct CursorObject {
@@ -65,8 +66,8 @@ struct CursorObject {
     vao.set_access(attrVertex, 0, 0);
 
     ShaderProgram::init(program, vao);
-    pointerTx.init(sys::Path(dir) / sys::Path("assets"s) / sys::Path("pointer.png"s));
-    selectorTx.init(sys::Path(dir) / sys::Path("assets"s) / sys::Path("selector.png"s));
+    pointerTx.init_async(sys::Path(dir) / sys::Path("assets"s) / sys::Path("pointer.png"s));
+    selectorTx.init_async(sys::Path(dir) / sys::Path("assets"s) / sys::Path("selector.png"s));
     pointerTx.uSampler.set_id(program.id());
     selectorTx.uSampler.set_id(program.id());
     uTransform.set_id(program.id());
@@ -82,11 +83,11 @@ struct CursorObject {
   }
 
   void display() {
+    TRACE_SCOPE("CursorObject: display");
     ShaderProgram::use(program);
 
-    glEnable(GL_BLEND); GLERROR
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); GLERROR
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO); GLERROR
+    gl::State::enable(GL_BLEND);
+    gl::State::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 
     if(transform.has_changed) {
       glm::mat4 matrix = transform.get_matrix();
@@ -107,7 +108,7 @@ struct CursorObject {
     VertexArray::draw<GL_TRIANGLES>(vao);
 
     gl::Texture::unbind();
-    glDisable(GL_BLEND); GLERROR
+    gl::State::disable(GL_BLEND);
 
     ShaderProgram::unuse();
   }
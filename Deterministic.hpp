@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// math for the game simulation which gives bit-identical results on every
+// build and platform. only IEEE basic operations and sqrt are used, which are
+// correctly rounded everywhere, unlike the libm transcendental functions.
+// the build must not contract them into fused multiply-adds either
+namespace det {
+
+constexpr float PI = 3.14159265358979323846f;
+constexpr float HALF_PI = PI / 2;
+constexpr float TWO_PI = PI * 2;
+
+// maps angle to [-pi, pi]
+inline float wrap_angle(float angle) {
+  return angle - TWO_PI * std::floor(angle / TWO_PI + .5f);
+}
+
+inline float sin(float angle) {
+  float x = wrap_angle(angle);
+  // sin(x) = sin(pi - x) brings x to [-pi/2, pi/2]
+  if(x > HALF_PI) {
+    x = PI - x;
+  } else if(x < -HALF_PI) {
+    x = -PI - x;
+  }
+  const float x2 = x * x;
+  return x * (1.f - x2 / 6.f * (1.f - x2 / 20.f * (1.f - x2 / 42.f * (1.f - x2 / 72.f * (1.f - x2 / 110.f)))));
+}
+
+inline float cos(float angle) {
+  return det::sin(angle + HALF_PI);
+}
+
+// atan for |x| <= 1
+inline float atan_unit(float x) {
+  // atan(x) = 2 atan(x / (1 + sqrt(1 + x^2))) leaves |t| <= tan(pi/8)
+  const float t = x / (1.f + std::sqrt(1.f + x * x));
+  const float t2 = t * t;
+  float series = 1.f/15;
+  series = 1.f/13 - t2 * series;
+  series = 1.f/11 - t2 * series;
+  series = 1.f/9 - t2 * series;
+  series = 1.f/7 - t2 * series;
+  series = 1.f/5 - t2 * series;
+  series = 1.f/3 - t2 * series;
+  series = 1.f - t2 * series;
+  return 2.f * t * series;
+}
+
+inline float atan(float x) {
+  if(std::abs(x) <= 1.f) {
+    return atan_unit(x);
+  }
+  return (x > 0 ? HALF_PI : -HALF_PI) - atan_unit(1.f / x);
+}
+
+inline float atan2(float y, float x) {
+  if(x == 0.f) {
+    if(y == 0.f)return 0.f;
+    return (y > 0) ? HALF_PI : -HALF_PI;
+  }
+  if(std::abs(x) >= std::abs(y)) {
+    const float a = atan_unit(y / x);
+    if(x > 0)return a;
+    return (y >= 0) ? a + PI : a - PI;
+  }
+  const float a = atan_unit(x / y);
+  return (y > 0) ? HALF_PI - a : -HALF_PI - a;
+}
+
+// FNV-1a over the object representation of the fed values
+struct Hash {
+  uint64_t value = 14695981039346656037ull;
+
+  Hash()
+  {}
+
+  explicit Hash(uint64_t value):
+    value(value)
+  {}
+
+  template <typename T>
+  Hash &feed(const T &data) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&data);
+    for(size_t i = 0; i < sizeof(T); ++i) {
+      value = (value ^ bytes[i]) * 1099511628211ull;
+    }
+    return *this;
+  }
+};
+
+} // namespace det
@@ -34,6 +34,15 @@ std::string get_current_dir() {
   return s;
 }
 
+// one level, true if it is there afterwards
+bool make_directory(const std::string &dir) {
+#if defined(_POSIX_VERSION)
+  return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+#else
+  return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#endif
+}
+
 struct Path {
   const std::string p;
   inline explicit Path(const std::string &&p):
@@ -77,21 +86,6 @@ struct Path {
   }
 };
 
-namespace HACK {
-  void rename_file(const char *a, const char *b) {
-    int err = rename(a, b);
-    if(err)perror( "Error renaming file");
-  }
-
-  static void swap_files(std::string a, std::string b) {
-    assert(a != b);
-    const std::string TMP = sys::Path(a).directory() / sys::Path("dahfsjkgdhjsfgshjkgfdhjgfwfghjfhdgjsvfh"s);
-    rename_file(a.c_str(), TMP.c_str());
-    rename_file(b.c_str(), a.c_str());
-    rename_file(TMP.c_str(), b.c_str());
-  }
-} // namespace HACK
-
 std::string get_executable_directory(int argc, char *argv[]) {
 #ifdef __linux__
   std::vector<char> buf(PATH_MAX);
@@ -214,9 +208,8 @@ public:
   }
 
   std::string load_text() {
-    size_t size = length() + 1;
     std::string text;
-    text.resize(size);
+    text.resize(length());
 
     FILE *file = fopen(filename.c_str(), "r");
     if(file == nullptr) {
@@ -229,10 +222,8 @@ public:
     #endif
     sys::File::Lock fl(file);
 
-    int i = 0;
-    while((text[i] = fgetc(file)) != EOF)
-      ++i;
-    text[i] = '\0';
+    // in one read rather than a call per byte
+    text.resize(fread(&text[0], 1, text.size(), file));
 
     fl.drop();
 
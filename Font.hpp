@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdlib>
 #include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 #include "incfreetype.h"
@@ -12,22 +17,109 @@ namespace ui {
 struct Font {
   static FT_Library ft;
   static bool initialized;
-  FT_Face face;
   struct Character {
-    gl::Texture tex;
+    glm::vec2 uv_min, uv_max;
     glm::ivec2 size;
     glm::ivec2 bearing;
     GLuint advance;
 
-    Character(gl::Texture tex, glm::ivec2 size, glm::ivec2 bearing, GLuint advance):
-      tex(tex), size(size), bearing(bearing), advance(advance)
+    Character(glm::vec2 uv_min, glm::vec2 uv_max, glm::ivec2 size, glm::ivec2 bearing, GLuint advance):
+      uv_min(uv_min), uv_max(uv_max), size(size), bearing(bearing), advance(advance)
     {}
   };
-  std::map<GLchar, Character> alphabet;
+
+  // all glyphs of a face at one pixel size, packed into rows of a single
+  // texture. fonts with the same file and size share it
+  struct Atlas {
+    static constexpr int WIDTH = 512;
+    static constexpr int PADDING = 2;
+
+    gl::Texture tex;
+    std::map<GLchar, Character> alphabet;
+    int width = WIDTH, height = 0;
+    int refcount = 0;
+
+    Atlas():
+      tex("font_texture")
+    {}
+
+    void init(const std::string &filename, int pixel_size) {
+      FT_Face face;
+      int rc = FT_New_Face(ft, filename.c_str(), 0, &face);
+      ASSERT(!rc);
+      FT_Set_Pixel_Sizes(face, 0, pixel_size);
+
+      // first pass: place the glyphs, keeping their bitmaps
+      struct Bitmap {
+        int x, y;
+        int w, h;
+        std::vector<GLubyte> data;
+      };
+      std::vector<Bitmap> bitmaps(128);
+      int x = PADDING, y = PADDING, row_height = 0;
+      for(GLubyte c = 0; c < 128; ++c) {
+        int rc = FT_Load_Char(face, c, FT_LOAD_RENDER);
+        ASSERT(!rc);
+        const FT_Bitmap &bm = face->glyph->bitmap;
+        Bitmap &b = bitmaps[c];
+        b.w = bm.width, b.h = bm.rows;
+        ASSERT(b.w + 2 * PADDING <= width);
+        if(x + b.w + PADDING > width) {
+          x = PADDING;
+          y += row_height + PADDING;
+          row_height = 0;
+        }
+        b.x = x, b.y = y;
+        x += b.w + PADDING;
+        row_height = std::max(row_height, b.h);
+        const int pitch = std::abs(bm.pitch);
+        b.data.resize(b.w * b.h);
+        for(int r = 0; r < b.h; ++r) {
+          std::copy(bm.buffer + r * pitch, bm.buffer + r * pitch + b.w, b.data.begin() + r * b.w);
+        }
+        alphabet.insert({c, Character(
+          glm::vec2(0, 0), glm::vec2(0, 0),
+          glm::ivec2(bm.width, bm.rows),
+          glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+          GLuint(face->glyph->advance.x)
+        )});
+      }
+      FT_Done_Face(face);
+      height = 1;
+      while(height < y + row_height + PADDING) {
+        height <<= 1;
+      }
+
+      // second pass: copy into the atlas and set the texture coordinates
+      std::vector<GLubyte> pixels(width * height, 0);
+      for(GLubyte c = 0; c < 128; ++c) {
+        const Bitmap &b = bitmaps[c];
+        for(int r = 0; r < b.h; ++r) {
+          std::copy(b.data.begin() + r * b.w, b.data.begin() + (r + 1) * b.w, pixels.begin() + (b.y + r) * width + b.x);
+        }
+        Character &ch = alphabet.at(c);
+        ch.uv_min = glm::vec2(float(b.x) / width, float(b.y) / height);
+        ch.uv_max = glm::vec2(float(b.x + b.w) / width, float(b.y + b.h) / height);
+      }
+      tex.init(width, height, pixels.data());
+      LOG(INFO, GRAPHICS, "Initialized font atlas %dx%d from file %s (%dpx)\n", width, height, filename.c_str(), pixel_size);
+    }
+
+    void clear() {
+      tex.clear();
+      alphabet.clear();
+    }
+  };
+
+  using atlas_key_t = std::pair<std::string, int>;
+  static std::map<atlas_key_t, Atlas> atlases;
+
   std::string filename;
+  int pixel_size;
+  Atlas *atlas = nullptr;
 
-  Font(const std::string &filename):
-    filename(filename)
+  Font(const std::string &filename, int pixel_size=48):
+    filename(filename), pixel_size(pixel_size)
   {}
 
   static void setup() {
@@ -38,31 +130,32 @@ struct Font {
 
   void init() {
     ASSERT(initialized);
-    int rc = FT_New_Face(ft, filename.c_str(), 0, &face);
-    ASSERT(!rc);
-    FT_Set_Pixel_Sizes(face, 0, 48);
-
-    for(GLubyte c = 0; c < 128; ++c) {
-      int rc = FT_Load_Char(face, c, FT_LOAD_RENDER);
-      ASSERT(!rc);
-      alphabet.insert({c, Character(
-        gl::Texture("font_texture"),
-        glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-        glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-        GLuint(face->glyph->advance.x)
-      )});
-      ASSERT(alphabet.find(c) != std::end(alphabet));
-      alphabet.at(c).tex.init(&face->glyph);
+    ASSERT(atlas == nullptr);
+    atlas = &atlases[atlas_key_t(filename, pixel_size)];
+    if(atlas->refcount++ == 0) {
+      atlas->init(filename, pixel_size);
     }
-    Logger::Info("Initialized font from file %s\n", filename.c_str());
+    LOG(INFO, GRAPHICS, "Initialized font from file %s\n", filename.c_str());
+  }
+
+  gl::Texture &texture() {
+    return atlas->tex;
+  }
+
+  const Character &glyph(char c) const {
+    ASSERT(atlas != nullptr);
+    ASSERT(atlas->alphabet.find(c) != atlas->alphabet.end());
+    return atlas->alphabet.at(c);
   }
 
   void clear() {
     ASSERT(initialized);
-    FT_Done_Face(face);
-    for(auto &it : alphabet) {
-      it.second.tex.clear();
+    if(atlas == nullptr)return;
+    if(--atlas->refcount == 0) {
+      atlas->clear();
+      atlases.erase(atlas_key_t(filename, pixel_size));
     }
+    atlas = nullptr;
   }
 
   static void cleanup() {
@@ -72,4 +165,5 @@ struct Font {
 };
 FT_Library Font::ft;
 bool Font::initialized = false;
+std::map<Font::atlas_key_t, Font::Atlas> Font::atlases;
 }
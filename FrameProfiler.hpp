@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+#include "TimerQuery.hpp"
+
+// cpu times of the phases of the last HISTORY frames, and gpu times of the
+// draw passes among them. a phase which didn't run in a frame is negative
+struct FrameProfiler {
+  enum Phase {
+    POLL, UPLOAD, UPDATE, IDLE,
+    DISPLAY_MENU, DISPLAY_BACKGROUND, DISPLAY_SOCCER, DISPLAY_CURSOR, DISPLAY_HUD,
+    SWAP,
+    NO_PHASES
+  };
+  static constexpr const char *phase_names[] = {
+    "poll", "upload", "update", "idle",
+    "menu", "background", "soccer", "cursor", "hud",
+    "swap"
+  };
+  static constexpr size_t HISTORY = 512;
+
+  static constexpr bool is_draw_pass(Phase phase) {
+    return DISPLAY_MENU <= phase && phase <= DISPLAY_HUD;
+  }
+
+  struct Record {
+    float total;
+    float cpu[NO_PHASES];
+    float gpu[NO_PHASES];
+  };
+
+  struct Stats {
+    float mean = 0, p50 = 0, p99 = 0, max = 0;
+    size_t count = 0;
+  };
+
+  using clock_t = std::chrono::steady_clock;
+
+  Record records[HISTORY];
+  uint64_t frame = 0; // the frame being measured
+  clock_t::time_point frame_start;
+  clock_t::time_point phase_start[NO_PHASES];
+  gl::TimerQuery<4> gpu_queries[NO_PHASES];
+
+  FrameProfiler()
+  {}
+
+  static float since(clock_t::time_point start) {
+    return std::chrono::duration<float, std::milli>(clock_t::now() - start).count();
+  }
+
+  Record &current() {
+    return records[frame % HISTORY];
+  }
+
+  void init() {
+    for(int i = 0; i < NO_PHASES; ++i) {
+      if(is_draw_pass(Phase(i))) {
+        gpu_queries[i].init();
+      }
+    }
+  }
+
+  void begin_frame() {
+    Record &r = current();
+    r.total = -1;
+    std::fill(std::begin(r.cpu), std::end(r.cpu), -1.f);
+    std::fill(std::begin(r.gpu), std::end(r.gpu), -1.f);
+    frame_start = clock_t::now();
+  }
+
+  void end_frame() {
+    current().total = since(frame_start);
+    // results of earlier frames which are still in the history
+    for(int i = 0; i < NO_PHASES; ++i) {
+      if(!is_draw_pass(Phase(i)))continue;
+      gpu_queries[i].poll([&](uint64_t tag, double ms) mutable {
+        if(frame - tag < HISTORY) {
+          records[tag % HISTORY].gpu[i] = ms;
+        }
+      });
+    }
+    ++frame;
+  }
+
+  void begin(Phase phase) {
+    phase_start[phase] = clock_t::now();
+    if(is_draw_pass(phase)) {
+      gpu_queries[phase].begin(frame);
+    }
+  }
+
+  void end(Phase phase) {
+    if(is_draw_pass(phase)) {
+      gpu_queries[phase].end();
+    }
+    float &cpu = current().cpu[phase];
+    cpu = std::max(cpu, 0.f) + since(phase_start[phase]);
+  }
+
+  struct Scope {
+    FrameProfiler &profiler;
+    Phase phase;
+
+    Scope(FrameProfiler &profiler, Phase phase):
+      profiler(profiler), phase(phase)
+    {
+      profiler.begin(phase);
+    }
+
+    ~Scope() {
+      profiler.end(phase);
+    }
+  };
+
+  Scope scope(Phase phase) {
+    return Scope(*this, phase);
+  }
+
+  template <typename F>
+  Stats get_stats(F &&get_value) const {
+    std::vector<float> values;
+    values.reserve(HISTORY);
+    const size_t no_records = std::min<uint64_t>(frame, HISTORY);
+    for(size_t i = 0; i < no_records; ++i) {
+      const float value = get_value(records[(frame - 1 - i) % HISTORY]);
+      if(value >= 0) {
+        values.push_back(value);
+      }
+    }
+    Stats stats;
+    stats.count = values.size();
+    if(values.empty())return stats;
+    for(float v : values) {
+      stats.mean += v;
+    }
+    stats.mean /= values.size();
+    auto p50 = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), p50, values.end());
+    stats.p50 = *p50;
+    auto p99 = values.begin() + (values.size() * 99) / 100;
+    std::nth_element(values.begin(), p99, values.end());
+    stats.p99 = *p99;
+    stats.max = *std::max_element(values.begin(), values.end());
+    return stats;
+  }
+
+  Stats frame_stats() const {
+    return get_stats([](const Record &r) { return r.total; });
+  }
+
+  Stats cpu_stats(Phase phase) const {
+    return get_stats([=](const Record &r) { return r.cpu[phase]; });
+  }
+
+  Stats gpu_stats(Phase phase) const {
+    return get_stats([=](const Record &r) { return r.gpu[phase]; });
+  }
+
+  // one line per frame of the history, oldest first. empty cells for the
+  // phases which didn't run
+  void dump_csv(const std::string &filename) const {
+    FILE *fp = fopen(filename.c_str(), "w");
+    if(fp == nullptr) {
+      LOG(ERROR, GRAPHICS, "profiler: unable to open '%s'\n", filename.c_str());
+      return;
+    }
+    fprintf(fp, "frame,total");
+    for(int i = 0; i < NO_PHASES; ++i) {
+      fprintf(fp, ",%s_cpu", phase_names[i]);
+      if(is_draw_pass(Phase(i))) {
+        fprintf(fp, ",%s_gpu", phase_names[i]);
+      }
+    }
+    fprintf(fp, "\n");
+    const uint64_t first = frame - std::min<uint64_t>(frame, HISTORY);
+    auto write_value = [&](float value) mutable {
+      if(value >= 0) {
+        fprintf(fp, ",%.3f", value);
+      } else {
+        fprintf(fp, ",");
+      }
+    };
+    for(uint64_t f = first; f < frame; ++f) {
+      const Record &r = records[f % HISTORY];
+      fprintf(fp, "%lu,%.3f", f, r.total);
+      for(int i = 0; i < NO_PHASES; ++i) {
+        write_value(r.cpu[i]);
+        if(is_draw_pass(Phase(i))) {
+          write_value(r.gpu[i]);
+        }
+      }
+      fprintf(fp, "\n");
+    }
+    fclose(fp);
+    LOG(INFO, GRAPHICS, "profiler: wrote %lu frames to '%s'\n", frame - first, filename.c_str());
+  }
+
+  void clear() {
+    for(int i = 0; i < NO_PHASES; ++i) {
+      if(is_draw_pass(Phase(i))) {
+        gpu_queries[i].clear();
+      }
+    }
+  }
+};
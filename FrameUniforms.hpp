@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <incgraphics.h>
+#include <Debug.hpp>
+#include <Logger.hpp>
+#include <GLState.hpp>
+
+namespace gl {
+// per-frame data shared by all programs through one uniform buffer, uploaded
+// once per frame. a shader gets it by declaring
+//
+//   layout (std140) uniform Frame {
+//     mat4 camera;
+//     float time;
+//   };
+//
+// programs are attached to the binding point when they are linked
+struct FrameUniforms {
+  static constexpr GLuint BINDING = 0;
+  static constexpr const char *BLOCK_NAME = "Frame";
+
+  // std140 layout of the block
+  struct Data {
+    glm::mat4 camera;
+    GLfloat time;
+    GLfloat padding[3];
+  };
+
+  static inline GLuint ubo = 0;
+
+  static void init() {
+    if(ubo != 0)return;
+    glGenBuffers(1, &ubo); GLERROR
+    gl::State::bind_buffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_DYNAMIC_DRAW); GLERROR
+    gl::State::bind_buffer_base(GL_UNIFORM_BUFFER, BINDING, ubo);
+  }
+
+  static void attach(GLuint program_id) {
+    const GLuint index = glGetUniformBlockIndex(program_id, BLOCK_NAME); GLERROR
+    if(index == GL_INVALID_INDEX)return;
+    glUniformBlockBinding(program_id, index, BINDING); GLERROR
+  }
+
+  static void update(const glm::mat4 &camera, float time) {
+    ASSERT(ubo != 0);
+    Data data;
+    data.camera = camera;
+    data.time = time;
+    gl::State::bind_buffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &data); GLERROR
+    gl::State::unbind_buffer(GL_UNIFORM_BUFFER);
+  }
+
+  static void clear() {
+    if(ubo == 0)return;
+    glDeleteBuffers(1, &ubo); GLERROR
+    gl::State::forget_buffer(ubo);
+    ubo = 0;
+  }
+};
+} // namespace gl
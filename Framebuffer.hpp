@@ -1,9 +1,12 @@
 #pragma once
 
+#include <vector>
+
 #include "incgraphics.h"
 #include "Debug.hpp"
 #include "Logger.hpp"
-#include "Renderbuffer.hpp"
+#include "RenderBuffer.hpp"
+#include "GLState.hpp"
 
 namespace gl {
 struct Framebuffer {
@@ -54,7 +57,7 @@ struct Framebuffer {
     GLuint tex = 0;
 
     glGenTextures(1, &tex); GLERROR
-    glBindTexture(GL_TEXTURE_2D, tex); GLERROR
+    gl::State::bind_texture(tex);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); GLERROR
@@ -84,6 +87,9 @@ struct Framebuffer {
 
   static void clear(gl::Framebuffer &fb) {
     glDeleteTextures(fb.textures.size(), fb.textures.data()); GLERROR
+    for(GLuint tex : fb.textures) {
+      gl::State::forget_texture(tex);
+    }
     glDeleteFramebuffers(1, &fb.fbo); GLERROR
   }
 
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+
+#include <incgraphics.h>
+#include <Debug.hpp>
+#include <Logger.hpp>
+
+namespace gl {
+// the last known value of the pieces of GL state the wrappers change, so that
+// setting what is already set doesn't reach the driver. there is one GL
+// context per process, so this is static. unbinding is lazy: unbind_*()
+// leaves the object bound and the next bind replaces it, which turns the
+// bind/unbind pairs around every draw into nothing. all of this state has to
+// be changed through here, reset() forgets it when a context is created
+struct State {
+  static constexpr GLuint UNKNOWN = UINT_MAX;
+  static constexpr int MAX_TEXTURE_UNITS = 16;
+
+  static inline GLuint program = UNKNOWN;
+  static inline GLuint vertex_array = UNKNOWN;
+  static inline GLuint array_buffer = UNKNOWN;
+  static inline GLuint uniform_buffer = UNKNOWN;
+  static inline GLuint active_texture_unit = UNKNOWN;
+  static inline GLuint textures[MAX_TEXTURE_UNITS];
+  static inline GLint blend = -1, depth_test = -1;
+  static inline GLenum blend_func[4] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+
+  // calls made and calls skipped since the start
+  static inline uint64_t no_calls = 0;
+  static inline uint64_t no_elided = 0;
+
+  static void reset() {
+    program = vertex_array = array_buffer = uniform_buffer = UNKNOWN;
+    active_texture_unit = UNKNOWN;
+    for(int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+      textures[i] = UNKNOWN;
+    }
+    blend = depth_test = -1;
+    for(int i = 0; i < 4; ++i) {
+      blend_func[i] = UNKNOWN;
+    }
+  }
+
+  static bool elide(bool same) {
+    if(same) {
+      ++no_elided;
+    } else {
+      ++no_calls;
+    }
+    return same;
+  }
+
+  static void use_program(GLuint id) {
+    if(elide(program == id))return;
+    glUseProgram(id); GLERROR
+    program = id;
+  }
+
+  static void unuse_program() {
+  }
+
+  static void bind_vertex_array(GLuint id) {
+    if(elide(vertex_array == id))return;
+    glBindVertexArray(id); GLERROR
+    vertex_array = id;
+  }
+
+  // while a vertex array stays bound, only buffers of other targets may be
+  // bound: the element array binding belongs to the vertex array
+  static void unbind_vertex_array() {
+  }
+
+  static GLuint *buffer_binding(GLenum target) {
+    switch(target) {
+      case GL_ARRAY_BUFFER: return &array_buffer;
+      case GL_UNIFORM_BUFFER: return &uniform_buffer;
+    }
+    return nullptr;
+  }
+
+  static void bind_buffer(GLenum target, GLuint id) {
+    GLuint *bound = buffer_binding(target);
+    if(elide(bound != nullptr && *bound == id))return;
+    glBindBuffer(target, id); GLERROR
+    if(bound != nullptr) {
+      *bound = id;
+    }
+  }
+
+  // array and uniform buffers stay bound until the next bind. so does the
+  // element array buffer: its binding belongs to the vertex array, which is
+  // always bound while one is used, and unbinding it would take the indices
+  // off the vertex array. any other target, e.g. a pixel buffer, changes how
+  // pixels are transferred while it is bound, so it is really unbound
+  static void unbind_buffer(GLenum target) {
+    if(buffer_binding(target) != nullptr)return;
+    if(target == GL_ELEMENT_ARRAY_BUFFER) {
+      ASSERT(vertex_array != UNKNOWN && vertex_array != 0);
+      return;
+    }
+    elide(false);
+    glBindBuffer(target, 0); GLERROR
+  }
+
+  // also binds id to the generic binding point of target
+  static void bind_buffer_base(GLenum target, GLuint index, GLuint id) {
+    elide(false);
+    glBindBufferBase(target, index, id); GLERROR
+    GLuint *bound = buffer_binding(target);
+    if(bound != nullptr) {
+      *bound = id;
+    }
+  }
+
+  static void set_active_texture(GLuint unit) {
+    if(elide(active_texture_unit == unit))return;
+    glActiveTexture(GL_TEXTURE0 + unit); GLERROR
+    active_texture_unit = unit;
+  }
+
+  static void bind_texture(GLuint id) {
+    GLuint *bound = (active_texture_unit < MAX_TEXTURE_UNITS) ? &textures[active_texture_unit] : nullptr;
+    if(elide(bound != nullptr && *bound == id))return;
+    glBindTexture(GL_TEXTURE_2D, id); GLERROR
+    if(bound != nullptr) {
+      *bound = id;
+    }
+  }
+
+  static void unbind_texture() {
+  }
+
+  static GLint *capability(GLenum cap) {
+    switch(cap) {
+      case GL_BLEND: return &blend;
+      case GL_DEPTH_TEST: return &depth_test;
+    }
+    return nullptr;
+  }
+
+  static void set_enabled(GLenum cap, bool enabled) {
+    GLint *state = capability(cap);
+    if(elide(state != nullptr && *state == GLint(enabled)))return;
+    if(enabled) {
+      glEnable(cap); GLERROR
+    } else {
+      glDisable(cap); GLERROR
+    }
+    if(state != nullptr) {
+      *state = enabled;
+    }
+  }
+
+  static void enable(GLenum cap) {
+    set_enabled(cap, true);
+  }
+
+  static void disable(GLenum cap) {
+    set_enabled(cap, false);
+  }
+
+  static void set_blend_func(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    const bool same = blend_func[0] == src_rgb && blend_func[1] == dst_rgb
+                   && blend_func[2] == src_alpha && blend_func[3] == dst_alpha;
+    if(elide(same))return;
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha); GLERROR
+    blend_func[0] = src_rgb, blend_func[1] = dst_rgb;
+    blend_func[2] = src_alpha, blend_func[3] = dst_alpha;
+  }
+
+  // deleting a bound object unbinds it, a deleted program stays in use
+  // until another one is
+  static void forget_program(GLuint id) {
+    if(program == id) {
+      program = UNKNOWN;
+    }
+  }
+
+  static void forget_vertex_array(GLuint id) {
+    if(vertex_array == id) {
+      vertex_array = 0;
+    }
+  }
+
+  static void forget_buffer(GLuint id) {
+    if(array_buffer == id) {
+      array_buffer = 0;
+    }
+    if(uniform_buffer == id) {
+      uniform_buffer = 0;
+    }
+  }
+
+  static void forget_texture(GLuint id) {
+    for(int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+      if(textures[i] == id) {
+        textures[i] = 0;
+      }
+    }
+  }
+};
+} // namespace gl
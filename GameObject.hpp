@@ -6,23 +6,31 @@
 #include "Soccer.hpp"
 #include "BackgroundObject.hpp"
 #include "SoccerObject.hpp"
+#include "FrameProfiler.hpp"
+#include "FrameUniforms.hpp"
+#include "RenderQueue.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
 
 struct GameObject {
   Camera cam;
   BackgroundObject backgrObj;
   SoccerObject soccerObject;
+  gl::RenderQueue queue;
 
   ui::CursorObject &cursor; // no ownership, but may modify
+  FrameProfiler &profiler;
 
   size_t w_width;
   size_t w_height;
 
   Timer::time_t current_time = 0.;
 
-  GameObject(Soccer &soccer, Intelligence<IntelligenceType::ABSTRACT> &intelligence, ui::CursorObject &cursor, const std::string &dir):
+  GameObject(Soccer &soccer, Intelligence<IntelligenceType::ABSTRACT> &intelligence, ui::CursorObject &cursor, FrameProfiler &profiler, const std::string &dir):
     backgrObj(dir),
     soccerObject(soccer, intelligence, dir),
-    cursor(cursor)
+    cursor(cursor),
+    profiler(profiler)
   {}
 
   bool is_active() {
@@ -30,7 +38,8 @@ struct GameObject {
   }
 
   void init() {
-    Logger::Info("gobject: intiialized\n");
+    LOG(INFO, GRAPHICS, "gobject: intiialized\n");
+    gl::FrameUniforms::init();
     backgrObj.init();
     soccerObject.init();
   }
@@ -62,14 +71,27 @@ struct GameObject {
   }
 
   void display() {
+    TRACE_SCOPE("GameObject: display");
     if(!is_active())return;
-    backgrObj.display(cam);
-    soccerObject.display(cam);
+    gl::FrameUniforms::update(cam.get_matrix(), Timer::frame_time());
+    queue.begin(cam.cameraPos);
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_BACKGROUND);
+      backgrObj.submit(queue, cam);
+    }
+    // the background is drawn along with the rest of the queue
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_SOCCER);
+      soccerObject.submit(queue, cam);
+      queue.execute();
+    }
   }
 
   void clear() {
-    Logger::Info("gobject: clearance\n");
+    LOG(INFO, GRAPHICS, "gobject: clearance\n");
     backgrObj.clear();
     soccerObject.clear();
+    queue.clear();
+    gl::FrameUniforms::clear();
   }
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <epoxy/egl.h>
+
+#include "incgraphics.h"
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "GLState.hpp"
+
+// a GL 3.2 core context without a window or a display server, for rendering
+// into framebuffers only. surfaceless EGL works with mesa's llvmpipe on
+// machines without a GPU
+struct HeadlessContext {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+
+  HeadlessContext()
+  {}
+
+  static EGLDisplay get_display() {
+    if(epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+      return eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  void init() {
+    display = get_display();
+    ASSERT(display != EGL_NO_DISPLAY);
+    EGLint major, minor;
+    EGLBoolean rc = eglInitialize(display, &major, &minor);
+    ASSERT(rc == EGL_TRUE);
+    LOG(INFO, GRAPHICS, "headless: EGL %d.%d, %s\n", major, minor, eglQueryString(display, EGL_VENDOR));
+    ASSERT(epoxy_has_egl_extension(display, "EGL_KHR_surfaceless_context"));
+
+    rc = eglBindAPI(EGL_OPENGL_API);
+    ASSERT(rc == EGL_TRUE);
+    // EGL_SURFACE_TYPE defaults to windows, which surfaceless has none of
+    const EGLint config_attribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_NONE
+    };
+    EGLConfig config;
+    EGLint no_configs = 0;
+    rc = eglChooseConfig(display, config_attribs, &config, 1, &no_configs);
+    ASSERT(rc == EGL_TRUE && no_configs > 0);
+    // the same as the window asks glfw for
+    const EGLint context_attribs[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 3,
+      EGL_CONTEXT_MINOR_VERSION, 2,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    ASSERT(context != EGL_NO_CONTEXT);
+    rc = eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    ASSERT(rc == EGL_TRUE);
+    gl::State::reset();
+    LOG(INFO, GRAPHICS, "headless: %s, OpenGL %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+  }
+
+  void clear() {
+    if(display == EGL_NO_DISPLAY)return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(context != EGL_NO_CONTEXT) {
+      eglDestroyContext(display, context);
+      context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+  }
+};
@@ -19,7 +19,7 @@
 namespace img {
 
 Image *load_image(sys::File &file) {
-  Logger::Info("Loading image file '%s'\n", file.name().c_str());
+  LOG(INFO, GRAPHICS, "Loading image file '%s'\n", file.name().c_str());
   Image *image = nullptr;
   if(!file.exists()) {
     TERMINATE("file '%s' not found", file.name().c_str());
@@ -28,21 +28,21 @@ Image *load_image(sys::File &file) {
 #ifdef COMPILE_IMGPNG
     image = new img::PNGImage(file.name().c_str());
 #else
-    Logger::Error("unable to open file %s: compiled without PNG support\n", file.name().c_str());
+    LOG(ERROR, GRAPHICS, "unable to open file %s: compiled without PNG support\n", file.name().c_str());
 #endif
   } else if(file.is_ext(".jpg") || file.is_ext(".jpeg")) {
 // jpeg
 #ifdef COMPILE_IMGJPEG
     image = new img::JPEGImage(file.name().c_str());
 #else
-    Logger::Error("unable to open file %s: compiled without JPEG support\n", file.name().c_str());
+    LOG(ERROR, GRAPHICS, "unable to open file %s: compiled without JPEG support\n", file.name().c_str());
 #endif
   } else if(file.is_ext(".tiff")) {
 // tiff
 #ifdef COMPILE_IMGTIFF
     image = new img::TIFFImage(file.name().c_str());
 #else
-    Logger::Error("unable to open file %s: compiled without TIFF support\n", file.name().c_str());
+    LOG(ERROR, GRAPHICS, "unable to open file %s: compiled without TIFF support\n", file.name().c_str());
 #endif
   } else if(file.is_ext(".bmp")) {
 // bmp
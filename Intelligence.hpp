@@ -3,7 +3,9 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <map>
 #include <set>
+#include <deque>
 #include <queue>
 #include <thread>
 #include <mutex>
@@ -12,13 +14,15 @@
 #include "Soccer.hpp"
 #include "Network.hpp"
 #include "Logger.hpp"
+#include "Trace.hpp"
 #include "Optimizations.hpp"
 
 enum class IntelligenceType : int8_t {
   ABSTRACT,
   SERVER,
   REMOTE,
-  COMPUTER
+  COMPUTER,
+  LOCKSTEP
 };
 
 template <IntelligenceType IntelligenceT> struct Intelligence;
@@ -63,6 +67,7 @@ struct Intelligence <IntelligenceType::ABSTRACT> {
 using SoccerServer = Intelligence<IntelligenceType::SERVER>;
 using SoccerRemote = Intelligence<IntelligenceType::REMOTE>;
 using SoccerComputer = Intelligence<IntelligenceType::COMPUTER>;
+using SoccerLockstep = Intelligence<IntelligenceType::LOCKSTEP>;
 
 namespace pkg {
   // listen/send action
@@ -112,9 +117,17 @@ namespace pkg {
     pkg::vec3 dest;
   } ATTRIB_PACKED;
 
+  // actions a client has gathered over one tick
+  struct action_batch_struct {
+    static constexpr int MAX_ACTIONS = 8;
+    uint8_t no_actions;
+    action_struct actions[MAX_ACTIONS];
+  } ATTRIB_PACKED;
+
   // send/listen to unit sync
   struct sync_struct {
-    int8_t id; // -1 for ball
+    static constexpr int8_t NO_UNIT = -2;
+    int8_t id; // -1 for ball, -2 for no unit
     int8_t ball_owner;
     pkg::vec3 pos;
     pkg::vec2 dest;
@@ -134,19 +147,30 @@ namespace pkg {
       return action.a != Action::NO_ACTION;
     }
 
+    // syncs of one frame are ordered by the actions they follow, the sync
+    // carrying an action goes before the others counting it
     constexpr bool operator==(const sync_struct &other) const {
-      return frame == other.frame;
+      return frame == other.frame && no_actions == other.no_actions && has_action() == other.has_action();
     }
     constexpr bool operator!=(const sync_struct &other) const {
-      return frame != other.frame;
+      return !operator==(other);
     }
     constexpr bool operator<(const sync_struct &other) const {
-      return frame < other.frame;
+      if(frame != other.frame)return frame < other.frame;
+      if(no_actions != other.no_actions)return no_actions < other.no_actions;
+      return has_action() && !other.has_action();
     }
     constexpr bool operator>(const sync_struct &other) const {
-      return frame > other.frame;
+      return other < *this;
     }
   } ATTRIB_PACKED;
+
+  // send/listen to heartbeat: no unit needs a sync, but no action occured
+  // until frame either
+  struct frame_struct {
+    Timer::time_t frame;
+    uint16_t no_actions;
+  } ATTRIB_PACKED;
 };
 
 template <>
@@ -161,12 +185,23 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
 
   std::set<net::Addr> clients;
 
+  // a unit is only resent when the position the clients extrapolate from its
+  // last sync is off by more than the threshold, or after keepalive seconds
+  Unit::real_t sync_error_threshold = 10 * Unit::GAUGE;
+  Timer::time_t sync_keepalive = 1.;
+  std::map<int, pkg::sync_struct> last_syncs;
+
+  // actions accepted from a single client per second, the rest are dropped
+  int max_actions_per_second = 20;
+  std::map<net::Addr, std::deque<Timer::time_t>> action_times;
+
   Intelligence(int id, Soccer &soccer, net::Socket<net::SocketType::UDP> &socket, std::set<net::Addr> clients):
     id_(id), soccer(soccer),
     socket(socket), clients(clients)
   {}
 
   static void run(SoccerServer *server) {
+    TRACE_THREAD("iserver");
     constexpr int EVENT_SYNC = 1;
     Timer timer;
     timer.set_time(Timer::system_time());
@@ -176,17 +211,15 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
         if(server->has_quit()) {
           return !server->should_stop();
         }
-        // send sync data for random unit showing that no action occured until a
+        // send sync data for the units the clients mispredict. if there are
+        // none, send a heartbeat showing that no action occured until a
         // certain time point
         Timer::time_t server_time = Timer::system_time();
         timer.set_time(server_time);
         if(timer.timed_out(EVENT_SYNC)) {
           timer.set_event(EVENT_SYNC);
-          std::lock_guard<std::recursive_mutex> guard(server->soccer.mtx);
-          int no_ids = server->soccer.team1.size() + server->soccer.team2.size() + 1;
-          int8_t unit_id = (rand() % no_ids) - 1;
-          for(const auto &addr : server->clients) {
-            server->socket.send(net::make_package(addr, server->get_sync_data(unit_id)));
+          if(!server->send_diverged_syncs()) {
+            server->send_heartbeat();
           }
         }
         return !server->should_stop();
@@ -196,18 +229,35 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
         if(server->has_quit() || server->clients.find(blob.addr) == std::end(server->clients)) {
           return !server->should_stop();
         }
-        // if this package seems to be action, perform action and send responses
-        blob.try_visit_as<pkg::action_struct>([&](const auto action) mutable {
-          server->perform_action(action);
-          {
-            std::lock_guard<std::recursive_mutex> guard(server->no_actions_mtx);
-            ++server->no_actions;
+        // if this package seems to be a batch of actions, perform them and send
+        // responses
+        blob.try_visit_as<pkg::action_batch_struct>([&](const auto &batch) mutable {
+          const int no_actions = std::min<int>(batch.no_actions, pkg::action_batch_struct::MAX_ACTIONS);
+          std::vector<pkg::action_struct> accepted;
+          for(int i = 0; i < no_actions; ++i) {
+            if(!server->allow_action(blob.addr)) {
+              LOG_RATE_LIMITED(WARNING, NET, 1., "iserver: dropped %d actions from %s\n", no_actions - i, blob.addr.to_str().c_str());
+              break;
+            }
+            accepted.push_back(batch.actions[i]);
+          }
+          // every action is synced in the order it was issued, so that the
+          // clients replay all of them. only the sync of the last action of a
+          // unit carries the unit's state, the earlier ones are action only
+          std::map<int, size_t> last_of_unit;
+          for(size_t i = 0; i < accepted.size(); ++i) {
+            last_of_unit[accepted[i].id] = i;
           }
-          {
+          for(size_t i = 0; i < accepted.size(); ++i) {
+            const pkg::action_struct &action = accepted[i];
             std::lock_guard<std::recursive_mutex> guard(server->soccer.mtx);
-            for(const auto &addr : server->clients) {
-              server->socket.send(net::make_package(addr, server->get_sync_data(action.id)));
+            server->perform_action(action);
+            {
+              std::lock_guard<std::recursive_mutex> aguard(server->no_actions_mtx);
+              ++server->no_actions;
             }
+            const bool last = last_of_unit[action.id] == i;
+            server->send_sync(last ? int(action.id) : pkg::sync_struct::NO_UNIT, action);
           }
         });
         return !server->should_stop();
@@ -215,11 +265,32 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
     );
   }
 
+  bool allow_action(const net::Addr &addr) {
+    const Timer::time_t now = Timer::system_time();
+    auto &times = action_times[addr];
+    while(!times.empty() && now - times.front() > 1.) {
+      times.pop_front();
+    }
+    if(int(times.size()) >= max_actions_per_second) {
+      return false;
+    }
+    times.push_back(now);
+    return true;
+  }
+
   pkg::sync_struct get_sync_data(int unit_id=Ball::NO_OWNER) {
     pkg::sync_struct usd;
     std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
     usd.id = unit_id;
     usd.frame = soccer.timer.current_time;
+    {
+      std::lock_guard<std::recursive_mutex> guard(no_actions_mtx);
+      usd.no_actions = no_actions;
+    }
+    // no unit state, e.g. for an action which a later sync of the unit covers
+    if(unit_id == pkg::sync_struct::NO_UNIT) {
+      return usd;
+    }
     if(unit_id == Ball::NO_OWNER) {
       usd.vertical_speed = soccer.ball.vertical_speed;
     } else {
@@ -232,11 +303,80 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
     usd.movement_speed = unit.moving_speed;
     usd.angle = unit.facing;
     usd.angle_dest = unit.facing_dest;
+    return usd;
+  }
+
+  bool needs_sync(int unit_id) {
+    std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
+    auto found = last_syncs.find(unit_id);
+    if(found == std::end(last_syncs)) {
+      return true;
+    }
+    const pkg::sync_struct &sync = found->second;
+    Timer::time_t timediff = soccer.timer.current_time - sync.frame;
+    if(timediff >= sync_keepalive) {
+      return true;
+    }
+    // the ball slows down, flies and bounces, which straight-line extrapolation
+    // does not predict: only a resting ball may skip its syncs
+    if(unit_id == Ball::NO_OWNER) {
+      const Ball &ball = soccer.ball;
+      if(sync.movement_speed != 0. || sync.vertical_speed != 0.
+         || ball.unit.moving_speed != 0. || ball.vertical_speed != 0.
+         || sync.ball_owner != ball.owner())
+      {
+        return true;
+      }
+    }
+    Unit::loc_t predicted = Unit::extrapolate(
+      sync.pos,
+      Unit::loc_t(sync.dest.x, sync.dest.y, 0),
+      sync.movement_speed,
+      timediff
+    );
+    return glm::distance(predicted, soccer.get_unit(unit_id).pos) > sync_error_threshold;
+  }
+
+  // the performed action travels with the sync, so that the clients can
+  // replay it at the same frame
+  void send_sync(int unit_id, pkg::action_struct action={.a=pkg::Action::NO_ACTION}) {
+    std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
+    pkg::sync_struct sync = get_sync_data(unit_id);
+    sync.action = action;
+    for(const auto &addr : clients) {
+      socket.send(net::make_package(addr, sync));
+    }
+    if(unit_id != pkg::sync_struct::NO_UNIT) {
+      last_syncs[unit_id] = sync;
+    }
+  }
+
+  bool send_diverged_syncs() {
+    std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
+    bool sent = false;
+    const int no_players = soccer.players.size();
+    for(int unit_id = Ball::NO_OWNER; unit_id < no_players; ++unit_id) {
+      if(needs_sync(unit_id)) {
+        send_sync(unit_id);
+        sent = true;
+      }
+    }
+    return sent;
+  }
+
+  void send_heartbeat() {
+    pkg::frame_struct heartbeat;
+    {
+      std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
+      heartbeat.frame = soccer.timer.current_time;
+    }
     {
       std::lock_guard<std::recursive_mutex> guard(no_actions_mtx);
-      usd.no_actions = no_actions;
+      heartbeat.no_actions = no_actions;
+    }
+    for(const auto &addr : clients) {
+      socket.send(net::make_package(addr, heartbeat));
     }
-    return usd;
   }
 
   void perform_action(pkg::action_struct action) {
@@ -254,6 +394,7 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
   }
 
   void idle(Timer::time_t curtime) {
+    TRACE_SCOPE("iserver: idle");
     soccer.idle(curtime);
   }
 
@@ -263,7 +404,7 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
 
   bool finalize = true;
   void start() {
-    Logger::Info("iserver: started\n");
+    LOG(INFO, NET, "iserver: started\n");
     ASSERT(should_stop());
     finalize = false;
     server_thread = std::thread(SoccerServer::run, this);
@@ -275,7 +416,12 @@ struct Intelligence<IntelligenceType::SERVER> : public Intelligence<Intelligence
       finalize = true;
     }
     server_thread.join();
-    Logger::Info("iserver: finished\n");
+    for(const auto &addr : clients) {
+      if(auto stats = socket.stats(addr)) {
+        LOG(INFO, NET, "iserver: client %s\n", stats->to_str().c_str());
+      }
+    }
+    LOG(INFO, NET, "iserver: finished\n");
   }
   bool should_stop() {
     std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
@@ -319,6 +465,7 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
   net::Socket<net::SocketType::UDP> &socket;
   int no_actions = 0;
   Timer::time_t last_frame = Timer::time_start();
+  Timer::time_t last_idle = Timer::time_start();
   std::thread client_thread;
   std::recursive_mutex frame_schedule_mtx;
   std::recursive_mutex finalize_mtx;
@@ -331,6 +478,7 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
   {}
 
   static void run(SoccerRemote *client) {
+    TRACE_THREAD("iclient");
     Timer::time_t delay = 1.;
     client->socket.listen(
       [&]() mutable {
@@ -340,6 +488,16 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
         if(client->has_quit() || blob.addr != client->server_addr) {
           return !client->should_stop();
         }
+        static_assert(net::Typecheck::all_distinct<pkg::sync_struct, pkg::frame_struct>);
+        // receive heartbeat, schedule it as a sync without unit
+        blob.try_visit_as<pkg::frame_struct>([&](const auto &heartbeat) mutable {
+          pkg::sync_struct sync;
+          sync.id = pkg::sync_struct::NO_UNIT;
+          sync.frame = heartbeat.frame;
+          sync.no_actions = heartbeat.no_actions;
+          std::lock_guard<std::recursive_mutex> guard(client->frame_schedule_mtx);
+          client->frame_schedule.push(sync);
+        });
         // receive package sync
         blob.try_visit_as<pkg::sync_struct>([&](const auto &sync) mutable {
           std::lock_guard<std::recursive_mutex> guard(client->frame_schedule_mtx);
@@ -361,8 +519,11 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
 
   std::queue<Timer::time_t> frames;
   static constexpr size_t FRAMERATE = 48;
+  // the simulation lagging behind by more than this waits for the server
+  static constexpr Timer::time_t STALL_THRESHOLD = .1;
 
   void process_frames(Timer::time_t max_frame) {
+    TRACE_SCOPE("iclient: process frames");
     /* printf("  processing frames up to %f\n", max_frame); */
     /* printf("  processing frame count: at most %lu\n", frames.size()); */
     int no_frames = 0;
@@ -377,6 +538,7 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
   }
 
   void unpack_sync_unit(const pkg::sync_struct &sync) {
+    if(sync.id == pkg::sync_struct::NO_UNIT)return;
     std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
     if(sync.id == Ball::NO_OWNER) {
       soccer.ball.vertical_speed = sync.vertical_speed;
@@ -416,6 +578,8 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
   }
 
   void idle(Timer::time_t curtime) {
+    TRACE_SCOPE("iclient: idle");
+    send_pending_actions();
     if(curtime <= Timer::time_start())return;
 
     constexpr Timer::time_t max_framediff = 1. / FRAMERATE;
@@ -425,6 +589,8 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
     }
 
     std::lock_guard<std::recursive_mutex> guard_frames(frame_schedule_mtx);
+    TRACE_COUNTER("iclient: scheduled syncs", frame_schedule.size());
+    TRACE_COUNTER("iclient: pending frames", frames.size());
     pkg::sync_struct next_event;
     /* printf("frame: %f\n", last_frame); */
     /* printf("curtime: %f\n", curtime); */
@@ -461,11 +627,15 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
     }
     // push current frame to the end.
     frames.push(curtime);
+    if(last_idle > Timer::time_start() && curtime - last_frame > STALL_THRESHOLD) {
+      socket.add_stall(server_addr, curtime - last_idle);
+    }
+    last_idle = curtime;
   }
 
   bool finalize = true;
   void start() {
-    Logger::Info("iclient: started\n");
+    LOG(INFO, NET, "iclient: started\n");
     ASSERT(should_stop());
     finalize = false;
     client_thread = std::thread(SoccerRemote::run, this);
@@ -477,17 +647,48 @@ struct Intelligence<IntelligenceType::REMOTE> : public Intelligence<Intelligence
       finalize = true;
     }
     client_thread.join();
-    Logger::Info("iclient: finished\n");
+    if(auto stats = socket.stats(server_addr)) {
+      LOG(INFO, NET, "iclient: server %s\n", stats->to_str().c_str());
+    }
+    LOG(INFO, NET, "iclient: finished\n");
   }
   bool should_stop() {
     std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
     return finalize;
   }
 
-  template <typename T>
-  void send_action(const T &data) {
-    printf("iclient: sending action %hhu\n", data.a);
-    socket.send(net::make_package(server_addr, data));
+  std::vector<pkg::action_struct> pending_actions;
+  std::recursive_mutex pending_actions_mtx;
+
+  // actions are sent once per tick. a move or a facing only decides where the
+  // player ends up, so it replaces one of the same kind queued right before it
+  void send_action(const pkg::action_struct &action) {
+    std::lock_guard<std::recursive_mutex> guard(pending_actions_mtx);
+    if(!pending_actions.empty()) {
+      pkg::action_struct &last = pending_actions.back();
+      if(last.a == action.a && (action.a == pkg::Action::M || action.a == pkg::Action::F)) {
+        last = action;
+        return;
+      }
+    }
+    pending_actions.push_back(action);
+  }
+
+  void send_pending_actions() {
+    std::lock_guard<std::recursive_mutex> guard(pending_actions_mtx);
+    constexpr size_t max_actions = pkg::action_batch_struct::MAX_ACTIONS;
+    for(size_t i = 0; i < pending_actions.size(); i += max_actions) {
+      pkg::action_batch_struct batch;
+      batch.no_actions = std::min(max_actions, pending_actions.size() - i);
+      std::copy(
+        std::begin(pending_actions) + i,
+        std::begin(pending_actions) + i + batch.no_actions,
+        batch.actions
+      );
+      LOG(DEBUG, NET, "iclient: sending %hhu actions\n", batch.no_actions);
+      socket.send(net::make_package(server_addr, batch));
+    }
+    pending_actions.clear();
   }
 
   void z_action() {
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <string>
+#include <utility>
+
+#include "Text.hpp"
+
+namespace ui {
+// labels of list entries, e.g. games or players, kept with their laid out
+// geometry from frame to frame. the string is only formatted again when the
+// value it is made from changes
+template <typename KeyT, typename ValueT>
+struct LabelCache {
+  struct Entry {
+    ValueT value;
+    ui::Text text;
+    bool used = true;
+
+    Entry(Font &font, const ValueT &value):
+      value(value), text(font)
+    {}
+  };
+
+  Font &font;
+  std::map<KeyT, Entry> entries;
+
+  LabelCache(Font &font):
+    font(font)
+  {}
+
+  template <typename F>
+  ui::Text &get(const KeyT &key, const ValueT &value, F &&format) {
+    auto it = entries.find(key);
+    if(it == std::end(entries)) {
+      it = entries.emplace(std::piecewise_construct,
+                           std::forward_as_tuple(key),
+                           std::forward_as_tuple(font, value)).first;
+      it->second.text.init();
+      it->second.text.set_text(format());
+    } else if(!(it->second.value == value)) {
+      it->second.value = value;
+      it->second.text.set_text(format());
+    }
+    it->second.used = true;
+    return it->second.text;
+  }
+
+  // drops the entries which weren't asked for since the last call
+  void prune() {
+    for(auto it = std::begin(entries); it != std::end(entries);) {
+      if(!it->second.used) {
+        it->second.text.clear();
+        it = entries.erase(it);
+      } else {
+        it->second.used = false;
+        ++it;
+      }
+    }
+  }
+
+  void clear() {
+    for(auto &it : entries) {
+      it.second.text.clear();
+    }
+    entries.clear();
+  }
+};
+} // namespace ui
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// loads in the background: a task is a job, file i/o and decoding that runs
+// on one of the workers, and an upload, the GL part of it, which the render
+// thread runs in slices of at most a budget per frame. an upload returns
+// false while it has more to do and gets another slice after the others.
+// without workers, before start() or in the tools, a task is done as soon
+// as it is given
+struct Loader {
+  using job_t = std::function<void()>;
+  using upload_t = std::function<bool()>;
+
+  struct Task {
+    uint64_t id;
+    job_t job;
+    upload_t upload;
+  };
+
+  static constexpr unsigned MAX_WORKERS = 4;
+
+  static inline std::vector<std::thread> workers;
+  static inline std::mutex mtx;
+  static inline std::condition_variable cv;
+  static inline bool stopping = false;
+  // waiting for a worker, and done by one and waiting for the render thread
+  static inline std::deque<Task> jobs, uploads;
+  static inline std::unordered_set<uint64_t> pending, cancelled;
+  static inline uint64_t last_id = 0;
+
+  static inline uint64_t no_tasks = 0;
+  static inline uint64_t no_slices = 0;
+
+  // one core is left to the render thread
+  static void start(unsigned no_workers=0) {
+    ASSERT(workers.empty());
+    if(no_workers == 0) {
+      no_workers = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, MAX_WORKERS);
+    }
+    stopping = false;
+    for(unsigned i = 0; i < no_workers; ++i) {
+      workers.emplace_back(Loader::run);
+    }
+    LOG(INFO, GRAPHICS, "loader: started %u workers\n", no_workers);
+  }
+
+  static void run() {
+    TRACE_THREAD("loader");
+    while(1) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, []() -> bool { return stopping || !jobs.empty(); });
+        if(stopping)return;
+        task = std::move(jobs.front());
+        jobs.pop_front();
+        if(cancelled.count(task.id)) {
+          cancelled.erase(task.id);
+          pending.erase(task.id);
+          continue;
+        }
+      }
+      {
+        TRACE_SCOPE("loader: job");
+        task.job();
+      }
+      std::lock_guard<std::mutex> guard(mtx);
+      uploads.push_back(std::move(task));
+    }
+  }
+
+  // what hasn't started by now is dropped, uploads included
+  static void stop() {
+    {
+      std::lock_guard<std::mutex> guard(mtx);
+      stopping = true;
+    }
+    cv.notify_all();
+    for(auto &w : workers) {
+      w.join();
+    }
+    workers.clear();
+    if(!jobs.empty() || !uploads.empty()) {
+      LOG(INFO, GRAPHICS, "loader: dropping %lu jobs and %lu uploads\n", jobs.size(), uploads.size());
+    }
+    jobs.clear();
+    uploads.clear();
+    pending.clear();
+    cancelled.clear();
+  }
+
+  // an id to cancel the task with
+  static uint64_t load(job_t job, upload_t upload) {
+    ++no_tasks;
+    const uint64_t id = ++last_id;
+    if(workers.empty()) {
+      job();
+      while(!upload())++no_slices;
+      return id;
+    }
+    {
+      std::lock_guard<std::mutex> guard(mtx);
+      pending.insert(id);
+      jobs.push_back({id, std::move(job), std::move(upload)});
+    }
+    cv.notify_one();
+    return id;
+  }
+
+  // the upload of a task cancelled before it runs doesn't, a job already
+  // running finishes but is thrown away
+  static void cancel(uint64_t id) {
+    std::lock_guard<std::mutex> guard(mtx);
+    if(pending.count(id)) {
+      cancelled.insert(id);
+    }
+  }
+
+  static bool is_pending(uint64_t id) {
+    std::lock_guard<std::mutex> guard(mtx);
+    return pending.count(id) > 0;
+  }
+
+  static bool is_idle() {
+    std::lock_guard<std::mutex> guard(mtx);
+    return pending.empty();
+  }
+
+  // on the render thread once a frame. slices are run until budget seconds
+  // are spent, at least one if there is any
+  static void upload(Timer::time_t budget) {
+    const Timer::time_t start = Timer::system_time();
+    do {
+      Task task;
+      {
+        std::lock_guard<std::mutex> guard(mtx);
+        if(uploads.empty())return;
+        task = std::move(uploads.front());
+        uploads.pop_front();
+        if(cancelled.count(task.id)) {
+          cancelled.erase(task.id);
+          pending.erase(task.id);
+          continue;
+        }
+      }
+      ++no_slices;
+      const bool done = task.upload();
+      std::lock_guard<std::mutex> guard(mtx);
+      if(done) {
+        pending.erase(task.id);
+      } else {
+        uploads.push_back(std::move(task));
+      }
+    } while(Timer::system_time() - start < budget);
+  }
+};
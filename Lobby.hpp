@@ -10,10 +10,12 @@
 #include <set>
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 #include "Network.hpp"
 #include "Soccer.hpp"
 #include "Intelligence.hpp"
+#include "Lockstep.hpp"
 
 namespace pkg {
   enum class LobbyAction : int8_t {
@@ -29,6 +31,7 @@ namespace pkg {
     int8_t index;
     int8_t team1;
     int8_t team2;
+    int8_t lockstep;
   } ATTRIB_PACKED;
 
   struct lobby_query_struct {
@@ -173,6 +176,9 @@ public:
 
 struct LobbyActor {
   Lobby lobby;
+  // chosen by the host: run the game in lockstep instead of streaming state.
+  // toggled from the ui, read by the lobby thread
+  std::atomic<bool> lockstep = false;
   LobbyActor():
     lobby()
   {}
@@ -231,11 +237,17 @@ struct LobbyServer : LobbyActor {
   std::set<net::Addr> &metaservers;
   std::recursive_mutex &mservers_mtx;
 
+  // a dedicated server does not take part in the game itself, and registers
+  // its game on the metaservers under announce_name
+  bool dedicated = false;
+  std::string announce_name = "";
+
   Timer timer;
   Timer user_timer;
   static constexpr Timer::key_t EVENT_SEND_HELLO_MSERVERS = 1;
   static constexpr Timer::key_t EVENT_SEND_HELLO_USERS = 2;
   static constexpr Timer::key_t EVENT_CHECK_STATUSES = 3;
+  static constexpr Timer::key_t EVENT_ANNOUNCE_MSERVERS = 4;
 
   LobbyServer(net::Socket<net::SocketType::UDP> &socket, std::set<net::Addr> &metaservers, std::recursive_mutex &mservers_mtx):
     LobbyActor(),
@@ -254,9 +266,11 @@ struct LobbyServer : LobbyActor {
     timer.set_timeout(EVENT_SEND_HELLO_MSERVERS, Timer::time_t(1.));
     timer.set_timeout(EVENT_SEND_HELLO_USERS, Timer::time_t(1.));
     timer.set_timeout(EVENT_CHECK_STATUSES, Timer::time_t(3.));
+    timer.set_timeout(EVENT_ANNOUNCE_MSERVERS, Timer::time_t(5.));
   }
 
   static void run(LobbyServer *server) {
+    TRACE_THREAD("lserver");
     server->timer.set_time(Timer::system_time());
     server->socket.listen(
       [&]() mutable {
@@ -268,7 +282,7 @@ struct LobbyServer : LobbyActor {
         server->timer.set_time(Timer::system_time());
         // send hello to servers
         server->timer.periodic(EVENT_SEND_HELLO_MSERVERS, [&]() mutable {
-          Logger::Info("%.2f lserver: sending hello to metaservers\n", server->timer.current_time);
+          LOG(DEBUG, LOBBY, "%.2f lserver: sending hello to metaservers\n", server->timer.current_time);
           std::lock_guard<std::recursive_mutex> mguard(server->mservers_mtx);
           for(auto &m : server->metaservers) {
             server->socket.send(net::make_package(m, (pkg::metaserver_hello_struct){
@@ -276,6 +290,20 @@ struct LobbyServer : LobbyActor {
             }));
           }
         });
+        // (re-)register the game, metaservers only accept it from known users
+        if(!server->announce_name.empty()) {
+          server->timer.periodic(EVENT_ANNOUNCE_MSERVERS, [&]() mutable {
+            pkg::metaserver_host_struct data = {
+              .action = pkg::MSAction::HOST
+            };
+            data.set_name(server->announce_name);
+            LOG(DEBUG, LOBBY, "%.2f lserver: announcing game '%s' to metaservers\n", server->timer.current_time, data.name);
+            std::lock_guard<std::recursive_mutex> mguard(server->mservers_mtx);
+            for(auto &m : server->metaservers) {
+              server->socket.send(net::make_package(m, data));
+            }
+          });
+        }
         // send hello to clients
         server->timer.periodic(EVENT_SEND_HELLO_USERS, [&]() mutable {
           if(rand() % 3 || server->lobby.empty()) {
@@ -303,7 +331,7 @@ struct LobbyServer : LobbyActor {
                 return true;
               }
               if(server->user_timer.timed_out(Timer::key_t(u.ip))) {
-                Logger::Info("%.2f lserver: removing user %s\n", server->timer.current_time, u.to_str().c_str());
+                LOG(INFO, LOBBY, "%.2f lserver: removing user %s\n", server->timer.current_time, u.to_str().c_str());
                 exusers.insert(u);
               } else {
                 s += u.to_str() + " ";
@@ -316,7 +344,7 @@ struct LobbyServer : LobbyActor {
               server->action_kick(u);
             }
           }
-          Logger::Info("%.2f lserver: users [ %s]\n", server->timer.current_time, s.c_str());
+          LOG(DEBUG, LOBBY, "%.2f lserver: users [ %s]\n", server->timer.current_time, s.c_str());
         });
         return !server->should_stop();
       },
@@ -331,7 +359,7 @@ struct LobbyServer : LobbyActor {
         // received hello from client
         static_assert(net::Typecheck::all_distinct<pkg::lobby_hello_struct, pkg::lobby_query_struct>);
         blob.try_visit_as<pkg::lobby_hello_struct>([&](const auto hello) mutable {
-          Logger::Info("%.2f received signal %d from %s\n", server->timer.current_time, hello.action, blob.addr.to_str().c_str());
+          LOG(DEBUG, LOBBY, "%.2f received signal %d from %s\n", server->timer.current_time, hello.action, blob.addr.to_str().c_str());
           switch(hello.action) {
             case pkg::LobbyAction::NOTHING:break;
             case pkg::LobbyAction::CONNECT:
@@ -368,8 +396,10 @@ struct LobbyServer : LobbyActor {
 
   bool finalize = false;
   void start() {
-    Logger::Info("lserver: started\n");
-    lobby.add_participant(host(), IntelligenceType::SERVER);
+    LOG(INFO, LOBBY, "lserver: started\n");
+    if(!dedicated) {
+      lobby.add_participant(host(), IntelligenceType::SERVER);
+    }
     finalize = false;
     server_thread = std::thread(LobbyServer::run, this);
   }
@@ -383,7 +413,11 @@ struct LobbyServer : LobbyActor {
       finalize = true;
     }
     server_thread.join();
-    Logger::Info("lserver: finished\n");
+    // the listener may have exited before it noticed a start
+    if(has_started()) {
+      trigger_events();
+    }
+    LOG(INFO, LOBBY, "lserver: finished\n");
   }
   bool should_stop() {
     std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
@@ -418,11 +452,11 @@ struct LobbyServer : LobbyActor {
   }
 
   void action_unhost() {
-    Logger::Info("%.2f lserver: sending unhost action to clients\n", Timer::system_time());
+    LOG(INFO, LOBBY, "%.2f lserver: sending unhost action to clients\n", Timer::system_time());
     send_action((pkg::lobby_hello_struct){
       .action = pkg::LobbyAction::UNHOST
     });
-    Logger::Info("%.2f lserver: sending unhost action to metaservers\n", Timer::system_time());
+    LOG(INFO, LOBBY, "%.2f lserver: sending unhost action to metaservers\n", Timer::system_time());
     {
       std::lock_guard<std::recursive_mutex> guard(mservers_mtx);
       for(auto &m : metaservers) {
@@ -434,7 +468,7 @@ struct LobbyServer : LobbyActor {
   }
 
   void action_gstart() {
-    Logger::Info("%.2f lserver: sending start action to clients\n", Timer::system_time());
+    LOG(INFO, LOBBY, "%.2f lserver: sending start action to clients\n", Timer::system_time());
     lobby.iterate([&](auto &p) mutable {
       const auto &u = p.first;
       if(u == host()) {
@@ -444,7 +478,8 @@ struct LobbyServer : LobbyActor {
         .action = pkg::LobbyAction::START,
         .index = int8_t(lobby[u].ind),
         .team1 = int8_t(lobby.team1()),
-        .team2 = int8_t(lobby.team2())
+        .team2 = int8_t(lobby.team2()),
+        .lockstep = int8_t(lockstep)
       }));
       return true;
     });
@@ -457,7 +492,7 @@ struct LobbyServer : LobbyActor {
 
   void action_join(net::Addr addr) {
     Timer::time_t server_time = Timer::system_time();
-    Logger::Info("%.2f lserver: sending action join for %s to clients\n", server_time, addr.to_str().c_str());
+    LOG(INFO, LOBBY, "%.2f lserver: sending action join for %s to clients\n", server_time, addr.to_str().c_str());
     lobby.add_participant(addr);
     send_action((pkg::lobby_query_response_struct){
       .addr = addr,
@@ -471,7 +506,7 @@ struct LobbyServer : LobbyActor {
 
   void action_kick(net::Addr addr) {
     Timer::time_t server_time = Timer::system_time();
-    Logger::Info("%.2f lserver: sending action kick for %s to clients\n", server_time, addr.to_str().c_str());
+    LOG(INFO, LOBBY, "%.2f lserver: sending action kick for %s to clients\n", server_time, addr.to_str().c_str());
     lobby.remove_participant(addr);
     send_action((pkg::lobby_query_response_struct){
       .addr = addr,
@@ -489,7 +524,15 @@ struct LobbyServer : LobbyActor {
       }
       return true;
     });
-    return new SoccerServer(lobby[host()].ind, soccer, socket, clients);
+    const int id = dedicated ? Ball::NO_OWNER : lobby[host()].ind;
+    if(lockstep) {
+      std::map<net::Addr, int8_t> peer_players;
+      for(const auto &addr : clients) {
+        peer_players[addr] = lobby[addr].ind;
+      }
+      return new SoccerLockstep(id, soccer, socket, peer_players);
+    }
+    return new SoccerServer(id, soccer, socket, clients);
   }
 };
 
@@ -503,6 +546,7 @@ struct LobbyClient : LobbyActor {
     int ind;
     int team1;
     int team2;
+    bool lockstep;
   } gameMaker;
   std::recursive_mutex gmaker_mtx;
 
@@ -534,6 +578,7 @@ struct LobbyClient : LobbyActor {
   }
 
   static void run(LobbyClient *client) {
+    TRACE_THREAD("lclient");
     client->timer.set_time(Timer::system_time());
     client->timer.set_event(EVENT_HOST_ACTIVITY);
     client->socket.listen(
@@ -545,12 +590,12 @@ struct LobbyClient : LobbyActor {
         client->timer.set_time(Timer::system_time());
         client->timer.periodic(EVENT_SEND_HELLO, [&]() mutable {
           if(rand() % 3 || client->lobby.empty()) {
-            Logger::Info("%.2f lclient: sending hello\n", client->timer.current_time);
+            LOG(DEBUG, LOBBY, "%.2f lclient: sending hello\n", client->timer.current_time);
             client->send_action((pkg::lobby_hello_struct){
               .action = pkg::LobbyAction::NOTHING
             });
           } else {
-            Logger::Info("%.2f lclient: sending query\n", client->timer.current_time);
+            LOG(DEBUG, LOBBY, "%.2f lclient: sending query\n", client->timer.current_time);
             client->send_action((pkg::lobby_query_struct){
               .action = pkg::LobbyAction::QUERY,
               .addr = client->lobby.random()
@@ -558,7 +603,7 @@ struct LobbyClient : LobbyActor {
           }
         });
         if(client->timer.timed_out(EVENT_HOST_ACTIVITY) && !client->has_quit()) {
-          Logger::Info("%.2f lclient: host timed out (%.2fs)\n", client->timer.current_time, client->timer.elapsed(EVENT_HOST_ACTIVITY));
+          LOG(INFO, LOBBY, "%.2f lclient: host timed out (%.2fs)\n", client->timer.current_time, client->timer.elapsed(EVENT_HOST_ACTIVITY));
           client->action_leave();
         }
         return !client->should_stop();
@@ -576,16 +621,16 @@ struct LobbyClient : LobbyActor {
         // received idle ping from host
         blob.try_visit_as<pkg::lobby_hello_struct>([&](const auto hello) mutable {
           if(hello.action == pkg::LobbyAction::UNHOST) {
-            Logger::Info("%.2f lclient: received UNHOST\n", client->timer.current_time);
+            LOG(INFO, LOBBY, "%.2f lclient: received UNHOST\n", client->timer.current_time);
             client->action_leave();
             return;
           } else {
-            Logger::Info("%.2f lclient: received ping\n", client->timer.current_time);
+            LOG(DEBUG, LOBBY, "%.2f lclient: received ping\n", client->timer.current_time);
           }
         });
         // received lobby query response
         blob.try_visit_as<pkg::lobby_query_response_struct>([&](const auto qresp) mutable {
-          Logger::Info("%.2f lclient: received query response for (%hhd, %d, %s):\n", client->timer.current_time, qresp.info.ind, qresp.info.team?1:0, qresp.addr.to_str().c_str());
+          LOG(DEBUG, LOBBY, "%.2f lclient: received query response for (%hhd, %d, %s):\n", client->timer.current_time, qresp.info.ind, qresp.info.team?1:0, qresp.addr.to_str().c_str());
           if(qresp.active) {
             client->lobby[qresp.addr] = qresp.info;
           } else if(client->lobby.find(qresp.addr)) {
@@ -594,12 +639,13 @@ struct LobbyClient : LobbyActor {
         });
         // received lobby start
         blob.try_visit_as<pkg::lobby_start_struct>([&](const auto start) mutable {
-          Logger::Info("%.2f lclient: received start package from server\n", client->timer.current_time);
+          LOG(INFO, LOBBY, "%.2f lclient: received start package from server\n", client->timer.current_time);
           {
             std::lock_guard<std::recursive_mutex> guard(client->gmaker_mtx);
             client->gameMaker.ind = start.index;
             client->gameMaker.team1 = start.team1;
             client->gameMaker.team2 = start.team2;
+            client->gameMaker.lockstep = start.lockstep;
           }
           client->action_start();
         });
@@ -611,7 +657,7 @@ struct LobbyClient : LobbyActor {
   bool finalize = true;
   void start() {
     ASSERT(should_stop());
-    Logger::Info("lclient: started\n");
+    LOG(INFO, LOBBY, "lclient: started\n");
     finalize = false;
     socket.send(net::make_package(host, (pkg::lobby_hello_struct) {
       .action = pkg::LobbyAction::CONNECT
@@ -628,7 +674,7 @@ struct LobbyClient : LobbyActor {
       finalize = true;
     }
     client_thread.join();
-    Logger::Info("lclient: finished\n");
+    LOG(INFO, LOBBY, "lclient: finished\n");
   }
   bool should_stop() {
     std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
@@ -642,17 +688,17 @@ struct LobbyClient : LobbyActor {
   LobbyActor::State last_state = LobbyActor::State::DEFAULT;
   void trigger_events() {
     if(last_state != LobbyActor::State::QUIT && has_quit()) {
-      Logger::Info("lclient: triggered quit\n");
+      LOG(INFO, LOBBY, "lclient: triggered quit\n");
       last_state = LobbyActor::State::QUIT;
       action_quit();
     } else if(last_state != LobbyActor::State::STARTED && has_started()) {
-      Logger::Info("lclient: triggered start\n");
+      LOG(INFO, LOBBY, "lclient: triggered start\n");
       last_state = LobbyActor::State::STARTED;
     }
   }
 
   void action_quit() {
-    Logger::Info("lclient: sending action quit\n");
+    LOG(INFO, LOBBY, "lclient: sending action quit\n");
     send_action((pkg::lobby_hello_struct){
       .action = pkg::LobbyAction::DISCONNECT
     });
@@ -666,6 +712,9 @@ struct LobbyClient : LobbyActor {
 
   Intelligence<IntelligenceType::ABSTRACT> *make_intelligence(Soccer &soccer) {
     std::lock_guard<std::recursive_mutex> guard(gmaker_mtx);
+    if(gameMaker.lockstep) {
+      return new SoccerLockstep(gameMaker.ind, soccer, socket, host);
+    }
     return new SoccerRemote(gameMaker.ind, soccer, socket, host);
   }
 };
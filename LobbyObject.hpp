@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Button.hpp"
+#include "LabelCache.hpp"
 #include "Lobby.hpp"
 #include "StrConst.hpp"
+#include "Trace.hpp"
 
 struct LobbyObject {
   LobbyActor *lobbyActor = nullptr;
@@ -11,17 +13,23 @@ struct LobbyObject {
   C_STRING(btn_font, "assets/Verdana.ttf");
   ui::Button<btn_texture, btn_font> exit_button;
   ui::Button<btn_texture, btn_font> start_button;
+  ui::Button<btn_texture, btn_font> mode_button;
 
   C_STRING(infobarR_texture, "assets/infobar_red.png");
   C_STRING(infobarB_texture, "assets/infobar_blue.png");
   ui::Button<infobarR_texture, btn_font> infobarR;
   ui::Button<infobarB_texture, btn_font> infobarB;
+  ui::LabelCache<net::Addr, int> player_labelsR;
+  ui::LabelCache<net::Addr, int> player_labelsB;
 
   LobbyObject(const std::string &dir):
     exit_button(dir),
     start_button(dir),
+    mode_button(dir),
     infobarR(dir),
-    infobarB(dir)
+    infobarB(dir),
+    player_labelsR(*infobarR.font),
+    player_labelsB(*infobarB.font)
   {}
 
   bool is_active() {
@@ -37,6 +45,9 @@ struct LobbyObject {
     start_button.sety(.9, 1);
     start_button.init();
     start_button.label.set_text("Start");
+    mode_button.setx(.35, .65);
+    mode_button.sety(.9, 1);
+    mode_button.init();
     infobarR.init();
     infobarB.init();
   }
@@ -57,16 +68,22 @@ struct LobbyObject {
 
   template <typename ButtonT, typename F>
   void button_display(ButtonT &btn, F &&func) {
+    button_display(btn, btn.label, func);
+  }
+
+  template <typename ButtonT, typename F>
+  void button_display(ButtonT &btn, ui::Text &label, F &&func) {
     btn.mouse(cursorPosition.x, cursorPosition.y);
     if(clicked && (btn.region.contains(cursorPosition) || btn.state != ButtonT::DEFAULT_STATE)) {
       btn.mouse_click(click_button, click_action);
       clicked = false;
     }
     btn.action_on_click(func);
-    btn.display();
+    btn.display(label);
   }
 
   void display() {
+    TRACE_SCOPE("LobbyObject: display");
     if(!is_active())return;
     button_display(exit_button, [&]() mutable {
       lobbyActor->action_leave();
@@ -77,31 +94,43 @@ struct LobbyObject {
         lobbyActor->action_start();
       });
       if(!is_active())return;
+      mode_button.label.set_text(lobbyActor->lockstep ? "Lockstep" : "Streaming");
+      button_display(mode_button, [&]() mutable {
+        lobbyActor->lockstep = !lobbyActor->lockstep.load();
+      });
     }
 
     glm::vec2 xs(-.8, .0);
     glm::vec2 ys(-1., -.9);
     ys += .05;
     lobbyActor->lobby.iterate([&](auto &p) mutable {
+      auto format = [&]() {
+        return std::to_string(p.second.ind) + ": " + p.first.to_str();
+      };
       if(p.second.team == Soccer::Team::RED_TEAM) {
         infobarR.setx(xs.x, xs.y);
         infobarR.sety(ys.x, ys.y);
-        infobarR.label.set_text(std::to_string(p.second.ind) + ": " + p.first.to_str());
-        button_display(infobarR, [&]() mutable {});
+        ui::Text &label = player_labelsR.get(p.first, p.second.ind, format);
+        button_display(infobarR, label, [&]() mutable {});
       } else {
         infobarB.setx(xs.x, xs.y);
         infobarB.sety(ys.x, ys.y);
-        infobarB.label.set_text(std::to_string(p.second.ind) + ": " + p.first.to_str());
-        button_display(infobarB, [&]() mutable {});
+        ui::Text &label = player_labelsB.get(p.first, p.second.ind, format);
+        button_display(infobarB, label, [&]() mutable {});
       }
       ys += .12;
       return true;
     });
+    player_labelsR.prune();
+    player_labelsB.prune();
   }
 
   void clear() {
+    player_labelsR.clear();
+    player_labelsB.clear();
     exit_button.clear();
     start_button.clear();
+    mode_button.clear();
     infobarR.clear();
     infobarB.clear();
   }
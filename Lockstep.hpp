@@ -0,0 +1,372 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <mutex>
+
+#include "Soccer.hpp"
+#include "Network.hpp"
+#include "Intelligence.hpp"
+#include "Logger.hpp"
+#include "Trace.hpp"
+#include "Optimizations.hpp"
+
+namespace pkg {
+  // peer to host: actions not yet included into any tick
+  struct lockstep_input_struct {
+    static constexpr int MAX_ACTIONS = 8;
+    uint32_t ack_tick; // every tick before it has been received
+    uint32_t seq; // sequence number of actions[0]
+    uint8_t no_actions;
+    action_struct actions[MAX_ACTIONS];
+  } ATTRIB_PACKED;
+
+  // host to peer: the input set of a single tick
+  struct lockstep_tick_struct {
+    static constexpr int MAX_ACTIONS = 8;
+    static constexpr uint32_t NO_TICK = std::numeric_limits<uint32_t>::max();
+    uint32_t tick;
+    uint32_t ack_seq; // every action of the receiver before it is in some tick
+    uint32_t checksum_tick; // rolling state hash of the host after checksum_tick
+    uint64_t checksum;
+    uint8_t no_actions;
+    action_struct actions[MAX_ACTIONS];
+  } ATTRIB_PACKED;
+}
+
+// every peer simulates the game itself, only the inputs of each tick are
+// exchanged. the host decides which actions go into which tick, peers only
+// advance once they have received the tick
+template <>
+struct Intelligence<IntelligenceType::LOCKSTEP> : public Intelligence<IntelligenceType::ABSTRACT> {
+  static constexpr Timer::time_t TICK = 1. / 48;
+  static constexpr Timer::time_t RESEND_INTERVAL = .1;
+  static constexpr uint32_t MAX_RESEND_TICKS = 8;
+  static constexpr uint32_t CHECKSUM_HISTORY = 256;
+  // a peer without a new tick for longer than this is stalled
+  static constexpr Timer::time_t STALL_THRESHOLD = .1;
+
+  int8_t id_;
+  Soccer &soccer;
+  net::Socket<net::SocketType::UDP> &socket;
+  const bool is_host;
+  net::Addr host_addr;
+  std::set<net::Addr> peers;
+  std::thread lockstep_thread;
+  std::recursive_mutex lockstep_mtx;
+  std::recursive_mutex finalize_mtx;
+
+  uint32_t next_tick = 0;
+  std::map<uint32_t, uint64_t> checksums;
+  // host: ticks some peer may still miss. peer: received, not simulated ticks
+  std::map<uint32_t, pkg::lockstep_tick_struct> ticks;
+
+  // host side
+  std::deque<pkg::action_struct> queued_actions;
+  // the player each peer controls, inputs for other players are rejected
+  std::map<net::Addr, int8_t> peer_players;
+  std::map<net::Addr, uint32_t> peer_seqs;
+  std::map<net::Addr, uint32_t> peer_acks;
+
+  // peer side
+  std::deque<pkg::action_struct> unacked_actions;
+  uint32_t first_unacked_seq = 0;
+  uint32_t next_unsent_seq = 0;
+  Timer::time_t last_tick_time = Timer::time_start();
+  Timer::time_t last_idle = Timer::time_start();
+
+  Timer timer;
+  static constexpr Timer::key_t EVENT_RESEND = 1;
+
+  // host
+  Intelligence(int id, Soccer &soccer, net::Socket<net::SocketType::UDP> &socket, const std::map<net::Addr, int8_t> &peer_players):
+    id_(id), soccer(soccer), socket(socket),
+    is_host(true), peer_players(peer_players)
+  {
+    for(const auto &[peer, player] : peer_players) {
+      peers.insert(peer);
+      peer_seqs[peer] = 0;
+      peer_acks[peer] = 0;
+    }
+    timer.set_timeout(EVENT_RESEND, RESEND_INTERVAL);
+  }
+
+  // peer
+  Intelligence(int id, Soccer &soccer, net::Socket<net::SocketType::UDP> &socket, net::Addr host_addr):
+    id_(id), soccer(soccer), socket(socket),
+    is_host(false), host_addr(host_addr)
+  {
+    timer.set_timeout(EVENT_RESEND, RESEND_INTERVAL);
+  }
+
+  static void run(SoccerLockstep *lockstep) {
+    TRACE_THREAD("ilockstep");
+    lockstep->socket.listen(
+      [&]() mutable {
+        return !lockstep->should_stop();
+      },
+      [&](const net::Blob &blob) mutable {
+        if(lockstep->has_quit()) {
+          return !lockstep->should_stop();
+        }
+        static_assert(net::Typecheck::all_distinct<pkg::lockstep_input_struct, pkg::lockstep_tick_struct>);
+        if(lockstep->is_host && lockstep->peers.find(blob.addr) != std::end(lockstep->peers)) {
+          blob.try_visit_as<pkg::lockstep_input_struct>([&](const auto &input) mutable {
+            lockstep->receive_input(blob.addr, input);
+          });
+        } else if(!lockstep->is_host && blob.addr == lockstep->host_addr) {
+          blob.try_visit_as<pkg::lockstep_tick_struct>([&](const auto &tick) mutable {
+            lockstep->receive_tick(tick);
+          });
+        }
+        return !lockstep->should_stop();
+      }
+    );
+  }
+
+  void receive_input(const net::Addr &addr, const pkg::lockstep_input_struct &input) {
+    std::lock_guard<std::recursive_mutex> guard(lockstep_mtx);
+    peer_acks[addr] = std::max(peer_acks[addr], input.ack_tick);
+    uint32_t &expected = peer_seqs[addr];
+    // a gap means some input got lost, it is going to be resent
+    if(input.seq > expected)return;
+    const int no_actions = std::min<int>(input.no_actions, pkg::lockstep_input_struct::MAX_ACTIONS);
+    for(int i = expected - input.seq; i < no_actions; ++i) {
+      ++expected;
+      if(input.actions[i].id != peer_players.at(addr)) {
+        LOG_RATE_LIMITED(WARNING, NET, 1., "ilockstep: rejected action for player %hhd from %s\n", input.actions[i].id, addr.to_str().c_str());
+        continue;
+      }
+      queued_actions.push_back(input.actions[i]);
+    }
+  }
+
+  void receive_tick(const pkg::lockstep_tick_struct &tick) {
+    std::lock_guard<std::recursive_mutex> guard(lockstep_mtx);
+    if(tick.tick >= next_tick) {
+      ticks[tick.tick] = tick;
+    }
+    while(!unacked_actions.empty() && first_unacked_seq < tick.ack_seq) {
+      unacked_actions.pop_front();
+      ++first_unacked_seq;
+    }
+    next_unsent_seq = std::max(next_unsent_seq, first_unacked_seq);
+  }
+
+  void perform_action(const pkg::action_struct &action) {
+    std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
+    switch(action.a) {
+      case pkg::Action::Z: soccer.z_action(action.id); break;
+      case pkg::Action::X: soccer.x_action(action.id, action.dir); break;
+      case pkg::Action::C: soccer.c_action(action.id, action.dest); break;
+      case pkg::Action::V: soccer.v_action(action.id); break;
+      case pkg::Action::F: soccer.f_action(action.id, action.dir); break;
+      case pkg::Action::S: soccer.s_action(action.id); break;
+      case pkg::Action::M: soccer.m_action(action.id, action.dest); break;
+      case pkg::Action::NO_ACTION:break;
+    }
+  }
+
+  // tick k always ends at (k + 1) * TICK, so that every peer feeds the same
+  // times into the simulation
+  void simulate(const pkg::lockstep_tick_struct &tick) {
+    ASSERT(tick.tick == next_tick);
+    if(tick.checksum_tick != pkg::lockstep_tick_struct::NO_TICK) {
+      auto found = checksums.find(tick.checksum_tick);
+      if(found != std::end(checksums) && found->second != tick.checksum) {
+        LOG(ERROR, NET, "lockstep: desync after tick %u (%016llx, host %016llx)\n",
+          tick.checksum_tick, (unsigned long long)found->second, (unsigned long long)tick.checksum);
+        leave();
+      }
+    }
+    const int no_actions = std::min<int>(tick.no_actions, pkg::lockstep_tick_struct::MAX_ACTIONS);
+    for(int i = 0; i < no_actions; ++i) {
+      perform_action(tick.actions[i]);
+    }
+    soccer.idle((next_tick + 1) * TICK);
+    checksums[next_tick] = soccer.rolling_hash;
+    if(next_tick >= CHECKSUM_HISTORY) {
+      checksums.erase(next_tick - CHECKSUM_HISTORY);
+    }
+    ++next_tick;
+  }
+
+  pkg::lockstep_tick_struct make_tick() {
+    pkg::lockstep_tick_struct tick;
+    tick.tick = next_tick;
+    tick.ack_seq = 0;
+    tick.checksum_tick = pkg::lockstep_tick_struct::NO_TICK;
+    tick.checksum = 0;
+    if(next_tick > 0) {
+      tick.checksum_tick = next_tick - 1;
+      tick.checksum = checksums.at(next_tick - 1);
+    }
+    tick.no_actions = 0;
+    while(!queued_actions.empty() && tick.no_actions < pkg::lockstep_tick_struct::MAX_ACTIONS) {
+      tick.actions[tick.no_actions++] = queued_actions.front();
+      queued_actions.pop_front();
+    }
+    return tick;
+  }
+
+  void send_tick(const net::Addr &peer, pkg::lockstep_tick_struct tick) {
+    tick.ack_seq = peer_seqs[peer];
+    socket.send(net::make_package(peer, tick));
+  }
+
+  void idle_host(Timer::time_t curtime) {
+    while((next_tick + 1) * TICK <= curtime) {
+      pkg::lockstep_tick_struct tick = make_tick();
+      ticks[tick.tick] = tick;
+      simulate(tick);
+      for(const auto &peer : peers) {
+        send_tick(peer, tick);
+      }
+    }
+    timer.periodic(EVENT_RESEND, [&]() mutable {
+      for(const auto &peer : peers) {
+        const uint32_t ack = peer_acks[peer];
+        for(uint32_t t = ack; t < next_tick && t < ack + MAX_RESEND_TICKS; ++t) {
+          send_tick(peer, ticks.at(t));
+        }
+      }
+    });
+    // forget the ticks every peer has
+    uint32_t min_ack = next_tick;
+    for(const auto &peer : peers) {
+      min_ack = std::min(min_ack, peer_acks[peer]);
+    }
+    while(!ticks.empty() && ticks.begin()->first < min_ack) {
+      ticks.erase(ticks.begin());
+    }
+  }
+
+  void send_input() {
+    pkg::lockstep_input_struct input;
+    input.ack_tick = next_tick;
+    while(ticks.find(input.ack_tick) != std::end(ticks)) {
+      ++input.ack_tick;
+    }
+    input.seq = first_unacked_seq;
+    input.no_actions = std::min<size_t>(unacked_actions.size(), pkg::lockstep_input_struct::MAX_ACTIONS);
+    std::copy(
+      std::begin(unacked_actions),
+      std::begin(unacked_actions) + input.no_actions,
+      input.actions
+    );
+    socket.send(net::make_package(host_addr, input));
+    next_unsent_seq = std::max(next_unsent_seq, first_unacked_seq + input.no_actions);
+  }
+
+  void idle_peer(Timer::time_t curtime) {
+    // new actions go out right away, everything else is repeated periodically
+    // in case it got lost, which also acknowledges the received ticks
+    if(next_unsent_seq < first_unacked_seq + unacked_actions.size()) {
+      send_input();
+      timer.set_event(EVENT_RESEND);
+    }
+    timer.periodic(EVENT_RESEND, [&]() mutable {
+      send_input();
+    });
+    while(ticks.find(next_tick) != std::end(ticks)) {
+      const pkg::lockstep_tick_struct tick = ticks.at(next_tick);
+      ticks.erase(next_tick);
+      simulate(tick);
+      last_tick_time = curtime;
+    }
+    if(curtime - last_tick_time > STALL_THRESHOLD) {
+      socket.add_stall(host_addr, curtime - last_idle);
+    }
+    last_idle = curtime;
+  }
+
+  void idle(Timer::time_t curtime) {
+    TRACE_SCOPE("ilockstep: idle");
+    std::lock_guard<std::recursive_mutex> guard(lockstep_mtx);
+    timer.set_time(curtime);
+    if(is_host) {
+      idle_host(curtime);
+    } else {
+      idle_peer(curtime);
+    }
+  }
+
+  int id() const {
+    return id_;
+  }
+
+  bool finalize = true;
+  void start() {
+    LOG(INFO, NET, "ilockstep: started as %s\n", is_host ? "host" : "peer");
+    ASSERT(should_stop());
+    finalize = false;
+    lockstep_thread = std::thread(SoccerLockstep::run, this);
+  }
+  void stop() {
+    ASSERT(!should_stop());
+    {
+      std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
+      finalize = true;
+    }
+    lockstep_thread.join();
+    for(const auto &addr : is_host ? peers : std::set<net::Addr>{host_addr}) {
+      if(auto stats = socket.stats(addr)) {
+        LOG(INFO, NET, "ilockstep: %s %s\n", is_host ? "peer" : "host", stats->to_str().c_str());
+      }
+    }
+    LOG(INFO, NET, "ilockstep: finished\n");
+  }
+  bool should_stop() {
+    std::lock_guard<std::recursive_mutex> guard(finalize_mtx);
+    return finalize;
+  }
+
+  void queue_action(const pkg::action_struct &action) {
+    std::lock_guard<std::recursive_mutex> guard(lockstep_mtx);
+    if(is_host) {
+      queued_actions.push_back(action);
+    } else {
+      unacked_actions.push_back(action);
+    }
+  }
+
+  void z_action() {
+    queue_action((pkg::action_struct){ .a=pkg::Action::Z, .id=id_ });
+  }
+
+  void x_action(float dir) {
+    pkg::action_struct d = { .a=pkg::Action::X, .id=id_, .dir=dir };
+    queue_action(d);
+  }
+
+  void c_action(glm::vec3 dest) {
+    pkg::action_struct d = { .a=pkg::Action::C, .id=id_ };
+    d.dest = dest;
+    queue_action(d);
+  }
+
+  void v_action() {
+    queue_action((pkg::action_struct){ .a=pkg::Action::V, .id=id_ });
+  }
+
+  void f_action(float dir) {
+    pkg::action_struct d = { .a=pkg::Action::F, .id=id_, .dir=dir };
+    queue_action(d);
+  }
+
+  void s_action() {
+    queue_action((pkg::action_struct){ .a=pkg::Action::S, .id=id_ });
+  }
+
+  void m_action(glm::vec3 dest) {
+    pkg::action_struct d = { .a=pkg::Action::M, .id=id_ };
+    d.dest = dest;
+    queue_action(d);
+  }
+};
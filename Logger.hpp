@@ -2,110 +2,381 @@
 
 #include <cstdarg>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iterator>
 
 #include <File.hpp>
 #include <Debug.hpp>
 
+// messages are formatted by the calling thread into its own ring, without
+// taking any lock. a background thread merges the rings in the order of the
+// messages and writes them out in batches
 class Logger {
+public:
+  enum class Level : uint8_t {
+    DEBUG, INFO, WARNING, ERROR, NONE
+  };
+  enum class Subsystem : uint8_t {
+    GENERAL, NET, LOBBY, METASERVER, GAME, GRAPHICS,
+    NO_SUBSYSTEMS
+  };
+private:
+  static constexpr const char *level_names[] = { "debug", "info", "warning", "error", "none" };
+  static constexpr const char *level_prefixes[] = { "DEBUG: ", "INFO: ", "WARN: ", "ERROR: ", "" };
+  static constexpr const char *subsystem_names[] = { "general", "net", "lobby", "metaserver", "game", "graphics" };
+  static std::atomic<uint8_t> levels[size_t(Subsystem::NO_SUBSYSTEMS)];
+
+  static constexpr size_t RING_SIZE = 1 << 16;
+  static constexpr size_t MAX_MESSAGE = 4096;
+  static constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(20);
+
+  // single producer, single consumer. an entry is a header and the text
+  struct Ring {
+    struct Header {
+      uint64_t seq;
+      uint32_t length;
+    };
+
+    char data[RING_SIZE];
+    std::atomic<size_t> head{0}; // written by the owning thread
+    std::atomic<size_t> tail{0}; // written by the writer thread
+    std::atomic<bool> owned{true};
+
+    void copy_in(size_t pos, const void *src, size_t len) {
+      const size_t offset = pos % RING_SIZE, first = std::min(len, RING_SIZE - offset);
+      memcpy(data + offset, src, first);
+      memcpy(data, (const char *)src + first, len - first);
+    }
+
+    void copy_out(size_t pos, void *dst, size_t len) const {
+      const size_t offset = pos % RING_SIZE, first = std::min(len, RING_SIZE - offset);
+      memcpy(dst, data + offset, first);
+      memcpy((char *)dst + first, data, len - first);
+    }
+
+    bool empty() const {
+      return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+  };
+
+  // keeps the ring of a thread, releases it for reuse once the thread exits
+  struct RingHandle {
+    uint64_t logger_id = 0;
+    std::shared_ptr<Ring> ring;
+
+    ~RingHandle() {
+      if(ring) {
+        ring->owned.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  const uint64_t id;
   std::vector<FILE *> files;
+  std::mutex files_mtx;
+
+  std::vector<std::shared_ptr<Ring>> rings;
+  std::mutex rings_mtx;
+  std::atomic<uint64_t> next_seq{0};
+
+  std::thread writer_thread;
+  std::mutex writer_mtx;
+  std::condition_variable writer_cv;
+  std::condition_variable flushed_cv;
+  uint64_t flush_requests = 0;
+  uint64_t flushed_requests = 0;
+  bool finalize = false;
+  std::string batch;
 
   static char *log_file;
   static FILE *log_file_ptr;
-  std::mutex mtx;
 
-  Logger()
-  {}
+  Logger():
+    id(++no_instances)
+  {
+    writer_thread = std::thread(Logger::run, this);
+  }
   ~Logger() {
+    {
+      std::lock_guard<std::mutex> guard(writer_mtx);
+      finalize = true;
+    }
+    writer_cv.notify_one();
+    writer_thread.join();
     for(FILE *fp : files) {
+      if(fp == stdout || fp == stderr)continue;
       fclose(fp);
     }
   }
   void AddOutputFilename(const char *filename) {
-    #ifndef NDEBUG
-      sys::File::truncate(filename);
-      FILE *fp = fopen(filename, "w");
-      if(fp != nullptr) {
-        AddOutputFile(fp);
-      } else {
-        fprintf(stderr, "error: unable to open log file '%s'\n", filename);
-      }
-    #endif
+    sys::File::truncate(filename);
+    FILE *fp = fopen(filename, "w");
+    if(fp != nullptr) {
+      AddOutputFile(fp);
+    } else {
+      fprintf(stderr, "error: unable to open log file '%s'\n", filename);
+    }
   }
 
   void AddOutputFile(FILE *fp) {
-    #ifndef NDEBUG
-      ASSERT(fp != nullptr);
-      files.push_back(fp);
-    #endif
-  }
-
-  void Write(const char *fmt, va_list args) {
-    #ifndef NDEBUG
-      std::lock_guard<std::mutex> guard(mtx);
-      for(FILE *fp : files) {
-        vfprintf(fp, fmt, args);
-        fflush(fp);
+    ASSERT(fp != nullptr);
+    std::lock_guard<std::mutex> guard(files_mtx);
+    files.push_back(fp);
+  }
+
+  size_t NoOutputFiles() {
+    std::lock_guard<std::mutex> guard(files_mtx);
+    return files.size();
+  }
+
+  Ring &GetRing() {
+    thread_local RingHandle handle;
+    if(handle.logger_id == id) {
+      return *handle.ring;
+    }
+    std::lock_guard<std::mutex> guard(rings_mtx);
+    handle.logger_id = id;
+    handle.ring.reset();
+    for(auto &ring : rings) {
+      if(!ring->owned.load(std::memory_order_acquire) && ring->empty()) {
+        ring->owned.store(true, std::memory_order_relaxed);
+        handle.ring = ring;
+        break;
+      }
+    }
+    if(!handle.ring) {
+      handle.ring = std::make_shared<Ring>();
+      rings.push_back(handle.ring);
+    }
+    return *handle.ring;
+  }
+
+  // messages of a subsystem other than the general one are tagged with its name
+  void Push(Level level, Subsystem subsystem, const char *fmt, va_list args) {
+    const char *prefix = level_prefixes[size_t(level)];
+    thread_local char message[MAX_MESSAGE];
+    const int prefix_length = (subsystem == Subsystem::GENERAL)
+      ? snprintf(message, MAX_MESSAGE, "%s", prefix)
+      : snprintf(message, MAX_MESSAGE, "%s[%s] ", prefix, subsystem_names[size_t(subsystem)]);
+    va_list argptr;
+    va_copy(argptr, args);
+    const int length = vsnprintf(message + prefix_length, MAX_MESSAGE - prefix_length, fmt, argptr);
+    va_end(argptr);
+    if(length < 0)return;
+    Ring &ring = GetRing();
+    Ring::Header header = {
+      .seq = 0,
+      .length = uint32_t(std::min<size_t>(prefix_length + length, MAX_MESSAGE - 1))
+    };
+    const size_t entry_size = sizeof(header) + header.length;
+    const size_t head = ring.head.load(std::memory_order_relaxed);
+    // the ring is full: wait for the writer rather than losing the message
+    while(head + entry_size - ring.tail.load(std::memory_order_acquire) > RING_SIZE) {
+      writer_cv.notify_one();
+      std::this_thread::yield();
+    }
+    header.seq = next_seq.fetch_add(1, std::memory_order_relaxed);
+    ring.copy_in(head, &header, sizeof(header));
+    ring.copy_in(head + sizeof(header), message, header.length);
+    ring.head.store(head + entry_size, std::memory_order_release);
+  }
+
+  // write everything published so far, oldest message first
+  void Drain() {
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+      std::lock_guard<std::mutex> guard(rings_mtx);
+      snapshot = rings;
+    }
+    std::vector<size_t> heads(snapshot.size()), tails(snapshot.size());
+    for(size_t i = 0; i < snapshot.size(); ++i) {
+      heads[i] = snapshot[i]->head.load(std::memory_order_acquire);
+      tails[i] = snapshot[i]->tail.load(std::memory_order_relaxed);
+    }
+    batch.clear();
+    while(1) {
+      int next = -1;
+      Ring::Header next_header;
+      for(size_t i = 0; i < snapshot.size(); ++i) {
+        if(tails[i] == heads[i])continue;
+        Ring::Header header;
+        snapshot[i]->copy_out(tails[i], &header, sizeof(header));
+        if(next == -1 || header.seq < next_header.seq) {
+          next = i, next_header = header;
+        }
       }
-    #endif
-  }
-  void WriteFmt(const char *prefix, const char *fmt, va_list args) {
-    #ifndef NDEBUG
-      std::lock_guard<std::mutex> guard(mtx);
-      for(FILE *fp : files) {
-        if(fp == nullptr)continue;
-        std::string s;
-        s += prefix;
-        s += fmt;
-        va_list argptr;
-        va_copy(argptr, args);
-        vfprintf(fp, s.c_str(), argptr);
-        fflush(fp);
+      if(next == -1)break;
+      const size_t offset = batch.size();
+      batch.resize(offset + next_header.length);
+      snapshot[next]->copy_out(tails[next] + sizeof(next_header), &batch[offset], next_header.length);
+      tails[next] += sizeof(next_header) + next_header.length;
+    }
+    for(size_t i = 0; i < snapshot.size(); ++i) {
+      snapshot[i]->tail.store(tails[i], std::memory_order_release);
+    }
+    if(batch.empty())return;
+    std::lock_guard<std::mutex> guard(files_mtx);
+    for(FILE *fp : files) {
+      fwrite(batch.data(), 1, batch.size(), fp);
+      fflush(fp);
+    }
+  }
+
+  static void run(Logger *logger) {
+    std::unique_lock<std::mutex> lock(logger->writer_mtx);
+    while(1) {
+      if(logger->flushed_requests == logger->flush_requests && !logger->finalize) {
+        logger->writer_cv.wait_for(lock, WRITE_INTERVAL);
+      }
+      const bool stop = logger->finalize;
+      const uint64_t requests = logger->flush_requests;
+      lock.unlock();
+      logger->Drain();
+      lock.lock();
+      if(logger->flushed_requests != requests) {
+        logger->flushed_requests = requests;
+        logger->flushed_cv.notify_all();
       }
-    #endif
+      if(stop)break;
+    }
+  }
+
+  // blocks until every message published before the call is written
+  void WaitFlushed() {
+    std::unique_lock<std::mutex> lock(writer_mtx);
+    const uint64_t request = ++flush_requests;
+    writer_cv.notify_one();
+    flushed_cv.wait(lock, [&]() { return flushed_requests >= request; });
   }
+
   static Logger *instance;
+  static uint64_t no_instances;
 public:
   static void Setup() {
     if(instance == nullptr) {
+      SetLevel(Level::INFO);
       instance = new Logger();
     }
   }
+  static bool Enabled(Level level, Subsystem subsystem) {
+    return uint8_t(level) >= levels[size_t(subsystem)].load(std::memory_order_relaxed);
+  }
+  static void SetLevel(Subsystem subsystem, Level level) {
+    levels[size_t(subsystem)].store(uint8_t(level), std::memory_order_relaxed);
+  }
+  static void SetLevel(Level level) {
+    for(size_t i = 0; i < size_t(Subsystem::NO_SUBSYSTEMS); ++i) {
+      SetLevel(Subsystem(i), level);
+    }
+  }
+  // comma-separated list of "level" or "subsystem=level", e.g. "warning,lobby=debug"
+  static bool SetLevels(const std::string &spec) {
+    size_t start = 0;
+    while(start <= spec.length()) {
+      size_t end = spec.find(',', start);
+      if(end == std::string::npos) {
+        end = spec.length();
+      }
+      const std::string item = spec.substr(start, end - start);
+      start = end + 1;
+      if(item.empty())continue;
+      const size_t eq = item.find('=');
+      const std::string level_name = (eq == std::string::npos) ? item : item.substr(eq + 1);
+      const std::string subsystem_name = (eq == std::string::npos) ? "" : item.substr(0, eq);
+      int level = -1, subsystem = -1;
+      for(size_t i = 0; i < std::size(level_names); ++i) {
+        if(level_name == level_names[i])level = i;
+      }
+      for(size_t i = 0; i < std::size(subsystem_names); ++i) {
+        if(subsystem_name == subsystem_names[i])subsystem = i;
+      }
+      if(level == -1 || (subsystem == -1 && !subsystem_name.empty())) {
+        return false;
+      }
+      if(subsystem == -1) {
+        SetLevel(Level(level));
+      } else {
+        SetLevel(Subsystem(subsystem), Level(level));
+      }
+    }
+    return true;
+  }
+  // opens a window of the given length in which the call site logs once.
+  // returns whether the caller may log, and how many calls were suppressed
+  static bool RateLimit(std::atomic<int64_t> &next_allowed, std::atomic<uint32_t> &no_suppressed, double seconds, uint32_t &suppressed) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+    int64_t allowed = next_allowed.load(std::memory_order_relaxed);
+    if(now < allowed || !next_allowed.compare_exchange_strong(allowed, now + int64_t(seconds * 1e9), std::memory_order_relaxed)) {
+      no_suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    suppressed = no_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  static void Write(Level level, Subsystem subsystem, const char *fmt, ...) {
+    ASSERT(instance != nullptr);
+    std::va_list argptr;
+    va_start(argptr, fmt);
+    instance->Push(level, subsystem, fmt, argptr);
+    va_end(argptr);
+    if(level >= Level::ERROR) {
+      instance->WaitFlushed();
+    }
+  }
   static void Say(const char *fmt, ...) {
     ASSERT(instance != nullptr);
+    if(!Enabled(Level::INFO, Subsystem::GENERAL))return;
     std::va_list argptr;
     va_start(argptr, fmt);
-    instance->Write(fmt, argptr);
+    instance->Push(Level::NONE, Subsystem::GENERAL, fmt, argptr);
     va_end(argptr);
   }
   static void Info(const char *fmt, ...) {
     ASSERT(instance != nullptr);
+    if(!Enabled(Level::INFO, Subsystem::GENERAL))return;
     std::va_list argptr;
     va_start(argptr, fmt);
-    instance->WriteFmt("INFO: ", fmt, argptr);
+    instance->Push(Level::INFO, Subsystem::GENERAL, fmt, argptr);
     va_end(argptr);
   }
   static void Warning(const char *fmt, ...) {
     ASSERT(instance != nullptr);
+    if(!Enabled(Level::WARNING, Subsystem::GENERAL))return;
     std::va_list argptr;
     va_start(argptr, fmt);
-    instance->WriteFmt("WARN: ", fmt, argptr);
+    instance->Push(Level::WARNING, Subsystem::GENERAL, fmt, argptr);
     va_end(argptr);
   }
+  // errors are never filtered and usually precede an abort, so they are
+  // written out right away
   static void Error(const char *fmt, ...) {
     ASSERT(instance != nullptr);
     std::va_list argptr;
     va_start(argptr, fmt);
-    instance->WriteFmt("ERROR: ", fmt, argptr);
+    instance->Push(Level::ERROR, Subsystem::GENERAL, fmt, argptr);
     va_end(argptr);
+    instance->WaitFlushed();
+  }
+  static void Flush() {
+    ASSERT(instance != nullptr);
+    instance->WaitFlushed();
   }
   static void SetLogOutput(const std::string &filename) {
     ASSERT(instance != nullptr);
     instance->AddOutputFilename(filename.c_str());
     Logger::Info("added output file '%s'\n", filename.c_str());
-    if(instance->files.size() == 1) {
+    if(instance->NoOutputFiles() == 1) {
       Logger::Info("Started log %s\n", filename.c_str());
     }
   }
@@ -113,7 +384,7 @@ public:
     ASSERT(instance != nullptr);
     instance->AddOutputFile(redir);
     Logger::Info("mirror log\n");
-    if(instance->files.size() == 1) {
+    if(instance->NoOutputFiles() == 1) {
       Logger::Info("Started log\n");
     }
   }
@@ -128,3 +399,50 @@ public:
 char *Logger::log_file  = nullptr;
 FILE *Logger::log_file_ptr  = nullptr;
 Logger *Logger::instance = nullptr;
+uint64_t Logger::no_instances = 0;
+std::atomic<uint8_t> Logger::levels[size_t(Logger::Subsystem::NO_SUBSYSTEMS)];
+
+// the level below which log statements are compiled out, e.g.
+// -DLOG_MIN_LEVEL=WARNING. debug messages are only kept in debug builds
+#ifndef LOG_MIN_LEVEL
+  #ifdef NDEBUG
+    #define LOG_MIN_LEVEL INFO
+  #else
+    #define LOG_MIN_LEVEL DEBUG
+  #endif
+#endif
+
+#define LOG_ENABLED(LEVEL, SUBSYSTEM) \
+  (Logger::Level::LEVEL >= Logger::Level::LOG_MIN_LEVEL \
+   && Logger::Enabled(Logger::Level::LEVEL, Logger::Subsystem::SUBSYSTEM))
+
+// arguments are only evaluated if the message gets logged
+#define LOG(LEVEL, SUBSYSTEM, ...) \
+  do { \
+    if(LOG_ENABLED(LEVEL, SUBSYSTEM)) { \
+      Logger::Write(Logger::Level::LEVEL, Logger::Subsystem::SUBSYSTEM, __VA_ARGS__); \
+    } \
+  } while(0)
+
+// logs the first of every N calls of the call site
+#define LOG_EVERY_N(LEVEL, SUBSYSTEM, N, ...) \
+  do { \
+    static std::atomic<uint32_t> log_no_calls_{0}; \
+    if(LOG_ENABLED(LEVEL, SUBSYSTEM) && log_no_calls_.fetch_add(1, std::memory_order_relaxed) % (N) == 0) { \
+      Logger::Write(Logger::Level::LEVEL, Logger::Subsystem::SUBSYSTEM, __VA_ARGS__); \
+    } \
+  } while(0)
+
+// logs the call site at most once per SECONDS
+#define LOG_RATE_LIMITED(LEVEL, SUBSYSTEM, SECONDS, ...) \
+  do { \
+    static std::atomic<int64_t> log_next_allowed_{0}; \
+    static std::atomic<uint32_t> log_no_suppressed_{0}; \
+    uint32_t log_suppressed_ = 0; \
+    if(LOG_ENABLED(LEVEL, SUBSYSTEM) && Logger::RateLimit(log_next_allowed_, log_no_suppressed_, SECONDS, log_suppressed_)) { \
+      if(log_suppressed_ > 0) { \
+        Logger::Write(Logger::Level::LEVEL, Logger::Subsystem::SUBSYSTEM, "(suppressed %u similar messages)\n", log_suppressed_); \
+      } \
+      Logger::Write(Logger::Level::LEVEL, Logger::Subsystem::SUBSYSTEM, __VA_ARGS__); \
+    } \
+  } while(0)
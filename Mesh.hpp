@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <utility>
 #include <glm/glm.hpp>
 
 #include "Debug.hpp"
@@ -9,6 +11,7 @@
 #include "ShaderProgram.hpp"
 #include "ShaderAttrib.hpp"
 #include "Texture.hpp"
+#include "RenderQueue.hpp"
 #include "StrConst.hpp"
 
 
@@ -20,16 +23,52 @@ struct ModelVertex {
   glm::vec3 bitan;
 };
 
+// what a mesh keeps on the GPU, 24 bytes for the 56 of a ModelVertex.
+// normal and tangent are signed normalized 2:10:10:10, the 2 bits of the
+// tangent hold the sign of the bitangent. texture coordinates are halfs
+struct PackedVertex {
+  glm::vec3 pos;
+  uint32_t nrm;
+  uint16_t txcoords[2];
+  uint32_t tangent;
+};
+static_assert(sizeof(PackedVertex) == 24);
+
 struct ModelTexture {
   GLuint id;
   std::string type;
   std::string texture_path;
 };
 
+// what one submit of shared geometry draws with in place of the mesh's own,
+// as the skin of a team: textures by sampler name, and the instance matrices,
+// pointed to as the packet draws since the vertex array is the same for all
+// variants
+struct Variant {
+  std::vector<std::pair<std::string, GLuint>> textures;
+  GLint instance_location = -1;
+  GLuint instance_buffer = 0;
+  size_t instance_offset = 0;
+
+  GLuint texture(const std::string &sampler, GLuint id) const {
+    for(const auto &t : textures) {
+      if(t.first == sampler)return t.second;
+    }
+    return id;
+  }
+};
+
 struct Mesh {
-  std::vector<ModelVertex> vertices;
+  std::vector<PackedVertex> vertices;
   std::vector<GLuint> indices;
+  // loaded from an asset pack, the data stays in the mapped file instead
+  const void *mapped_vertices = nullptr, *mapped_indices = nullptr;
+  size_t no_vertices = 0, no_indices = 0;
+  // 16 bit indices when the vertices allow
+  GLenum index_type = GL_UNSIGNED_INT;
   std::vector<ModelTexture> textures;
+  // texture_diffuse1, texture_specular1, ... in the order of textures
+  std::vector<gl::Uniform<gl::UniformType::SAMPLER2D>> uSamplers;
 
   gl::Buffer<GL_ARRAY_BUFFER, gl::BufferElementType::VEC3> vbo;
   gl::Buffer<GL_ELEMENT_ARRAY_BUFFER, gl::BufferElementType::VEC3> ebo;
@@ -38,30 +77,90 @@ struct Mesh {
     apos,
     anrm,
     atxc,
-    atng,
-    abtg;
+    atng;
 
   gl::VertexArray<
     decltype(apos),
     decltype(anrm),
     decltype(atxc),
-    decltype(atng),
-    decltype(abtg)
+    decltype(atng)
   > vao;
 
   using ShaderBufferVBO = decltype(vbo);
   using ShaderBufferEBO = decltype(ebo);
   using VertexArray = decltype(vao);
 
-  Mesh(const std::vector<ModelVertex> &vertices, const std::vector<GLuint> &indices, const std::vector<ModelTexture> &textures):
-    vertices(vertices), indices(indices), textures(textures),
+  Mesh(const std::vector<PackedVertex> &vertices, const std::vector<GLuint> &indices, const std::vector<ModelTexture> &textures):
+    vertices(vertices), indices(indices),
+    no_vertices(vertices.size()), no_indices(indices.size()),
+    index_type(vertices.size() <= UINT16_MAX + 1 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+    textures(textures),
     apos("aPos", ebo),
     anrm("aNormal", ebo),
     atxc("aTexCoords", ebo),
     atng("aTangent", ebo),
-    abtg("aBiTangent", ebo),
-    vao(apos, anrm, atxc, atng, abtg)
-  {}
+    vao(apos, anrm, atxc, atng)
+  {
+    set_samplers();
+  }
+
+  Mesh(const PackedVertex *vertices, size_t no_vertices, const void *indices, size_t no_indices, GLenum index_type, const std::vector<ModelTexture> &textures):
+    mapped_vertices(vertices), mapped_indices(indices),
+    no_vertices(no_vertices), no_indices(no_indices),
+    index_type(index_type),
+    textures(textures),
+    apos("aPos", ebo),
+    anrm("aNormal", ebo),
+    atxc("aTexCoords", ebo),
+    atng("aTangent", ebo),
+    vao(apos, anrm, atxc, atng)
+  {
+    set_samplers();
+  }
+
+  // the attributes refer to the buffers and the vertex array to the
+  // attributes of their own mesh, not to those of the one copied
+  Mesh(const Mesh &other):
+    vertices(other.vertices), indices(other.indices),
+    mapped_vertices(other.mapped_vertices), mapped_indices(other.mapped_indices),
+    no_vertices(other.no_vertices), no_indices(other.no_indices),
+    index_type(other.index_type),
+    textures(other.textures),
+    uSamplers(other.uSamplers),
+    vbo(other.vbo), ebo(other.ebo),
+    apos("aPos", ebo),
+    anrm("aNormal", ebo),
+    atxc("aTexCoords", ebo),
+    atng("aTangent", ebo),
+    vao(apos, anrm, atxc, atng)
+  {
+    vao.vaoId = other.vao.vaoId;
+  }
+
+  void set_samplers() {
+    GLuint
+      diffuseNr = 1,
+      specNr = 1,
+      normalNr = 1,
+      heightNr = 1;
+    for(GLuint i = 0; i < textures.size(); ++i) {
+      int number = 0;
+      const std::string &name = textures[i].type;
+      if(name == "texture_diffuse") {
+        number = (diffuseNr++);
+      } else if(name == "texture_specular") {
+        number = (specNr++);
+      } else if(name == "texture_normal") {
+        number = (normalNr++);
+      } else if(name == "texture_height") {
+        number = (heightNr++);
+      } else {
+        TERMINATE("unregistered shader attribute");
+      }
+      /* Logger::Info("Mesh: field %s\n", (name + number).c_str()); */
+      uSamplers.emplace_back(name + std::to_string(number));
+    }
+  }
 
   void init() {
     VertexArray::init(vao);
@@ -71,23 +170,33 @@ struct Mesh {
     ShaderBufferEBO::init(ebo);
 
     ShaderBufferVBO::bind(vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ModelVertex), &vertices[0], GL_STATIC_DRAW); GLERROR
-
     ShaderBufferEBO::bind(ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW); GLERROR
+    if(mapped_vertices != nullptr) {
+      const size_t index_size = (index_type == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(GLuint);
+      glBufferData(GL_ARRAY_BUFFER, no_vertices * sizeof(PackedVertex), mapped_vertices, GL_STATIC_DRAW); GLERROR
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, no_indices * index_size, mapped_indices, GL_STATIC_DRAW); GLERROR
+    } else {
+      glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), &vertices[0], GL_STATIC_DRAW); GLERROR
+      if(index_type == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(uint16_t), &short_indices[0], GL_STATIC_DRAW); GLERROR
+      } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW); GLERROR
+      }
+    }
 
     {
       vao.bind();
       vao.enable(apos);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), nullptr); GLERROR
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), nullptr); GLERROR
+      // the shaders read vec3 normals, w is dropped
       vao.enable(anrm);
-      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, nrm)); GLERROR
+      glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, nrm)); GLERROR
       vao.enable(atxc);
-      glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, txcoords)); GLERROR
+      glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, txcoords)); GLERROR
+      // bitangent = cross(normal, tangent.xyz) * tangent.w
       vao.enable(atng);
-      glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, tangent)); GLERROR
-      vao.enable(abtg);
-      glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex), (void*)offsetof(ModelVertex, bitan)); GLERROR
+      glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent)); GLERROR
       vao.unbind();
     }
 
@@ -96,49 +205,79 @@ struct Mesh {
     VertexArray::unbind();
   }
 
-  template <typename... ShaderTs>
-  void display(gl::ShaderProgram<ShaderTs...> &program) {
-    using ShaderProgram = gl::ShaderProgram<ShaderTs...>;
+  // per-instance model matrices for instanced draws, from offset in vbo
+  void set_instance_buffer(GLuint location, GLuint vbo, size_t offset=0) {
+    vao.set_instanced_mat4(location, vbo, offset);
+  }
 
-    ShaderProgram::use(program);
-    GLuint
-      diffuseNr = 1,
-      specNr = 1,
-      normalNr = 1,
-      heightNr = 1;
+  template <typename... ShaderTs>
+  void bind_textures(gl::ShaderProgram<ShaderTs...> &program) {
     for(GLuint i = 0; i < textures.size(); ++i) {
-      int number = 0;
-      const std::string &name = textures[i].type;
-      if(name == "texture_diffuse") {
-        number = (diffuseNr++);
-      } else if(name == "texture_specular") {
-        number = (specNr++);
-      } else if(name == "texture_normal") {
-        number = (normalNr++);
-      } else if(name == "texture_height") {
-        number = (heightNr++);
-      } else {
-        TERMINATE("unregistered shader attribute");
-      }
-      /* Logger::Info("Mesh: field %s\n", (name + number).c_str()); */
-      gl::Uniform<gl::UniformType::SAMPLER2D> uSampler((name + std::to_string(number)).c_str());
-      uSampler.set_id(program.id());
-      uSampler.set_data(i);
+      uSamplers[i].set_id(program.id());
+      uSamplers[i].set_data(i);
       gl::Texture::set_active(i);
       gl::Texture::bind(textures[i].id);
     }
+  }
+
+  template <typename... ShaderTs>
+  void display(gl::ShaderProgram<ShaderTs...> &program) {
+    using ShaderProgram = gl::ShaderProgram<ShaderTs...>;
+
+    ShaderProgram::use(program);
+    bind_textures(program);
+    VertexArray::bind(vao);
+    glDrawElements(GL_TRIANGLES, no_indices, index_type, 0); GLERROR
+    VertexArray::unbind();
+    ShaderProgram::unuse();
+  }
+
+  template <typename... ShaderTs>
+  void display_instanced(gl::ShaderProgram<ShaderTs...> &program, size_t no_instances) {
+    using ShaderProgram = gl::ShaderProgram<ShaderTs...>;
+
+    ShaderProgram::use(program);
+    bind_textures(program);
     VertexArray::bind(vao);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0); GLERROR
+    glDrawElementsInstanced(GL_TRIANGLES, no_indices, index_type, 0, no_instances); GLERROR
     VertexArray::unbind();
     ShaderProgram::unuse();
   }
 
+  // a packet per mesh on top of base, no_instances of 0 draws without
+  // instancing
+  template <typename... ShaderTs>
+  void submit(gl::RenderQueue &queue, const gl::RenderQueue::Packet &base, gl::ShaderProgram<ShaderTs...> &program, size_t no_instances=0, const Variant *variant=nullptr) {
+    gl::RenderQueue::Packet &p = queue.add(base);
+    p.program = program.id();
+    for(GLuint i = 0; i < textures.size(); ++i) {
+      uSamplers[i].set_id(program.id());
+      p.add_texture(variant != nullptr ? variant->texture(uSamplers[i].location, textures[i].id) : textures[i].id);
+    }
+    p.vertex_array = vao.id();
+    const GLint instance_location = variant != nullptr ? variant->instance_location : -1;
+    const GLuint instance_buffer = variant != nullptr ? variant->instance_buffer : 0;
+    const size_t instance_offset = variant != nullptr ? variant->instance_offset : 0;
+    p.draw = [this, no_instances, instance_location, instance_buffer, instance_offset]() mutable -> void {
+      for(GLuint i = 0; i < textures.size(); ++i) {
+        uSamplers[i].set_data(i);
+      }
+      if(instance_location != -1) {
+        vao.set_instanced_mat4(instance_location, instance_buffer, instance_offset);
+      }
+      if(no_instances == 0) {
+        glDrawElements(GL_TRIANGLES, no_indices, index_type, 0); GLERROR
+      } else {
+        glDrawElementsInstanced(GL_TRIANGLES, no_indices, index_type, 0, no_instances); GLERROR
+      }
+    };
+  }
+
   void clear() {
     apos.clear();
     anrm.clear();
     atxc.clear();
     atng.clear();
-    abtg.clear();
     ShaderBufferVBO::clear(vbo);
     ShaderBufferEBO::clear(ebo);
     VertexArray::clear(vao);
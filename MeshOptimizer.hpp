@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "Mesh.hpp"
+
+// import-time passes over a mesh before it goes to the GPU: vertices are
+// packed, identical packed vertices merged, triangles reordered for the
+// post-transform cache and vertices reordered in the order they are fetched
+namespace mesh {
+
+// signed normalized, x in the low bits as GL_INT_2_10_10_10_REV reads it
+inline uint32_t pack_snorm_2_10_10_10(const glm::vec3 &v, float w) {
+  auto snorm = [](float f, float scale, uint32_t mask) -> uint32_t {
+    f = std::min(std::max(f, -1.f), 1.f);
+    return uint32_t(int32_t(std::round(f * scale))) & mask;
+  };
+  return snorm(v.x, 511.f, 0x3ff)
+    | (snorm(v.y, 511.f, 0x3ff) << 10)
+    | (snorm(v.z, 511.f, 0x3ff) << 20)
+    | (snorm(w, 1.f, 0x3) << 30);
+}
+
+// IEEE half, rounded to nearest even
+inline uint16_t pack_half(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  const uint32_t sign = (x >> 16) & 0x8000;
+  const int32_t exp = int32_t((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+  if(((x >> 23) & 0xff) == 0xff) {
+    return sign | 0x7c00 | (mant ? 0x200 : 0);
+  } else if(exp >= 0x1f) {
+    return sign | 0x7c00;
+  } else if(exp <= 0) {
+    // subnormal or zero
+    if(exp < -10)return sign;
+    mant |= 0x800000;
+    const uint32_t shift = 14 - exp;
+    const uint32_t rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+    uint32_t h = mant >> shift;
+    if(rem > halfway || (rem == halfway && (h & 1)))++h;
+    return sign | h;
+  }
+  // a carry out of the mantissa rounds up into the exponent, as it should
+  uint32_t h = (uint32_t(exp) << 10) | (mant >> 13);
+  const uint32_t rem = mant & 0x1fff;
+  if(rem > 0x1000 || (rem == 0x1000 && (h & 1)))++h;
+  return sign | h;
+}
+
+inline PackedVertex pack(const ModelVertex &v) {
+  PackedVertex p;
+  p.pos = v.pos;
+  p.nrm = pack_snorm_2_10_10_10(v.nrm, 0.f);
+  p.txcoords[0] = pack_half(v.txcoords.x);
+  p.txcoords[1] = pack_half(v.txcoords.y);
+  // the bitangent is only kept as its side of the normal-tangent plane
+  const float handedness = glm::dot(glm::cross(v.nrm, v.tangent), v.bitan) < 0.f ? -1.f : 1.f;
+  p.tangent = pack_snorm_2_10_10_10(v.tangent, handedness);
+  return p;
+}
+
+// vertices that only differed below the packed precision become one
+inline void weld(std::vector<PackedVertex> &vertices, std::vector<GLuint> &indices) {
+  struct Hash {
+    size_t operator()(const PackedVertex &v) const {
+      // fnv-1a
+      const uint8_t *b = (const uint8_t *)&v;
+      uint64_t h = 14695981039346656037ULL;
+      for(size_t i = 0; i < sizeof(PackedVertex); ++i) {
+        h = (h ^ b[i]) * 1099511628211ULL;
+      }
+      return h;
+    }
+  };
+  struct Equal {
+    bool operator()(const PackedVertex &a, const PackedVertex &b) const {
+      return memcmp(&a, &b, sizeof(PackedVertex)) == 0;
+    }
+  };
+  std::unordered_map<PackedVertex, GLuint, Hash, Equal> unique;
+  unique.reserve(vertices.size());
+  std::vector<GLuint> remap(vertices.size());
+  std::vector<PackedVertex> welded;
+  welded.reserve(vertices.size());
+  for(size_t i = 0; i < vertices.size(); ++i) {
+    auto it = unique.emplace(vertices[i], GLuint(welded.size()));
+    if(it.second) {
+      welded.push_back(vertices[i]);
+    }
+    remap[i] = it.first->second;
+  }
+  for(auto &ind : indices) {
+    ind = remap[ind];
+  }
+  vertices.swap(welded);
+}
+
+// average cache miss ratio: transformed vertices per triangle with a fifo
+// cache of cache_size, 3 at worst and about 0.5 for a good order
+inline float acmr(const std::vector<GLuint> &indices, size_t no_vertices, size_t cache_size=16) {
+  if(indices.empty())return 0.f;
+  std::vector<size_t> stamps(no_vertices, 0);
+  size_t time = cache_size + 1, misses = 0;
+  for(GLuint ind : indices) {
+    if(time - stamps[ind] > cache_size) {
+      stamps[ind] = time++;
+      ++misses;
+    }
+  }
+  return float(misses) / float(indices.size() / 3);
+}
+
+// tom forsyth's linear-speed vertex cache optimisation: triangles are
+// emitted greedily by the scores of their vertices, which favour vertices
+// in a simulated lru cache and vertices with few triangles left
+inline void optimize_vertex_cache(std::vector<GLuint> &indices, size_t no_vertices) {
+  constexpr int CACHE_SIZE = 32;
+  constexpr float
+    CACHE_DECAY_POWER = 1.5f,
+    LAST_TRIANGLE_SCORE = .75f,
+    VALENCE_BOOST_SCALE = 2.f,
+    VALENCE_BOOST_POWER = .5f;
+
+  const size_t no_triangles = indices.size() / 3;
+  if(no_triangles == 0)return;
+
+  // triangles of each vertex, in one array
+  std::vector<GLuint> offsets(no_vertices + 1, 0);
+  for(GLuint ind : indices) {
+    ++offsets[ind + 1];
+  }
+  for(size_t i = 0; i < no_vertices; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<GLuint> vertex_triangles(indices.size());
+  std::vector<GLuint> remaining(no_vertices, 0);
+  for(size_t t = 0; t < no_triangles; ++t) {
+    for(int k = 0; k < 3; ++k) {
+      const GLuint v = indices[t * 3 + k];
+      vertex_triangles[offsets[v] + remaining[v]++] = t;
+    }
+  }
+
+  std::vector<int> cache_position(no_vertices, -1);
+  auto vertex_score = [&](GLuint v) -> float {
+    if(remaining[v] == 0)return -1.f;
+    float score = 0.f;
+    const int pos = cache_position[v];
+    if(pos >= 0) {
+      if(pos < 3) {
+        score = LAST_TRIANGLE_SCORE;
+      } else {
+        score = std::pow(1.f - float(pos - 3) / float(CACHE_SIZE - 3), CACHE_DECAY_POWER);
+      }
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(float(remaining[v]), -VALENCE_BOOST_POWER);
+  };
+
+  std::vector<float> vscores(no_vertices);
+  for(size_t v = 0; v < no_vertices; ++v) {
+    vscores[v] = vertex_score(v);
+  }
+  std::vector<float> tscores(no_triangles);
+  for(size_t t = 0; t < no_triangles; ++t) {
+    tscores[t] = vscores[indices[t*3]] + vscores[indices[t*3+1]] + vscores[indices[t*3+2]];
+  }
+
+  std::vector<bool> emitted(no_triangles, false);
+  std::vector<GLuint> result;
+  result.reserve(indices.size());
+  std::vector<GLuint> cache, next_cache;
+  cache.reserve(CACHE_SIZE + 3);
+  next_cache.reserve(CACHE_SIZE + 3);
+
+  size_t cursor = 0;
+  int64_t best = -1;
+  for(size_t no_emitted = 0; no_emitted < no_triangles; ++no_emitted) {
+    if(best < 0) {
+      // nothing in the cache to continue from, the next unemitted triangle
+      while(emitted[cursor])++cursor;
+      best = cursor;
+    }
+    const GLuint *tri = &indices[best * 3];
+    emitted[best] = true;
+    result.insert(result.end(), tri, tri + 3);
+
+    // drop the triangle from its vertices
+    for(int k = 0; k < 3; ++k) {
+      const GLuint v = tri[k];
+      GLuint *begin = &vertex_triangles[offsets[v]], *end = begin + remaining[v];
+      std::remove(begin, end, GLuint(best));
+      --remaining[v];
+    }
+
+    // the vertices of the triangle go to the front of the cache
+    next_cache.assign(tri, tri + 3);
+    for(GLuint v : cache) {
+      if(v != tri[0] && v != tri[1] && v != tri[2]) {
+        next_cache.push_back(v);
+      }
+    }
+    for(size_t i = 0; i < next_cache.size(); ++i) {
+      cache_position[next_cache[i]] = i < CACHE_SIZE ? int(i) : -1;
+      vscores[next_cache[i]] = vertex_score(next_cache[i]);
+    }
+    if(next_cache.size() > CACHE_SIZE) {
+      next_cache.resize(CACHE_SIZE);
+    }
+    cache.swap(next_cache);
+
+    // rescore the triangles touching the cache and continue from the best
+    best = -1;
+    float best_score = -1.f;
+    for(GLuint v : cache) {
+      for(GLuint i = 0; i < remaining[v]; ++i) {
+        const GLuint t = vertex_triangles[offsets[v] + i];
+        tscores[t] = vscores[indices[t*3]] + vscores[indices[t*3+1]] + vscores[indices[t*3+2]];
+        if(tscores[t] > best_score) {
+          best_score = tscores[t];
+          best = t;
+        }
+      }
+    }
+  }
+  indices.swap(result);
+}
+
+// vertices renumbered in the order the indices first use them, so that the
+// vertex fetches walk the buffer forward. unused vertices are dropped
+template <typename V>
+void optimize_vertex_fetch(std::vector<V> &vertices, std::vector<GLuint> &indices) {
+  std::vector<GLuint> remap(vertices.size(), UINT32_MAX);
+  std::vector<V> fetched;
+  fetched.reserve(vertices.size());
+  for(auto &ind : indices) {
+    if(remap[ind] == UINT32_MAX) {
+      remap[ind] = fetched.size();
+      fetched.push_back(vertices[ind]);
+    }
+    ind = remap[ind];
+  }
+  vertices.swap(fetched);
+}
+
+// all of the above, in order
+inline std::vector<PackedVertex> optimize(const std::vector<ModelVertex> &vertices, std::vector<GLuint> &indices) {
+  std::vector<PackedVertex> packed(vertices.size());
+  std::transform(vertices.begin(), vertices.end(), packed.begin(), pack);
+  const float acmr_before = acmr(indices, vertices.size());
+  weld(packed, indices);
+  optimize_vertex_cache(indices, packed.size());
+  optimize_vertex_fetch(packed, indices);
+  const size_t index_size = packed.size() <= UINT16_MAX + 1 ? sizeof(uint16_t) : sizeof(GLuint);
+  LOG(INFO, GRAPHICS, "mesh: %lu -> %lu vertices, %lu triangles, acmr %.3f -> %.3f, %lu -> %lu bytes\n",
+    vertices.size(), packed.size(), indices.size() / 3,
+    acmr_before, acmr(indices, packed.size()),
+    vertices.size() * sizeof(ModelVertex) + indices.size() * sizeof(GLuint),
+    packed.size() * sizeof(PackedVertex) + indices.size() * index_size);
+  return packed;
+}
+
+} // namespace mesh
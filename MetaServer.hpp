@@ -73,20 +73,21 @@ struct MetaServer {
   void run() {
     constexpr Timer::key_t EVENT_CHECK_STATUSES = 1;
     timer.set_timeout(EVENT_CHECK_STATUSES, Timer::time_t(3.));
-    Logger::Info("mserver: started at port %hu\n", socket.port());
+    LOG(INFO, METASERVER, "mserver: started at port %hu\n", socket.port());
+    TRACE_THREAD("mserver");
     socket.listen(
       [&]() mutable {
         timer.set_time(Timer::system_time());
         // clean up inactive users
         timer.periodic(EVENT_CHECK_STATUSES, [&]() mutable {
-          Logger::Info("mserver: cleaning up inactive users\n");
+          LOG(DEBUG, METASERVER, "mserver: cleaning up inactive users\n");
           user_timer.set_time(Timer::system_time());
           std::string s = "";
           // workaround because it fails when the iterated set changes
           std::set<net::Addr> exusers;
           for(auto &u : users) {
             if(user_timer.timed_out(Timer::key_t(u.ip))) {
-              Logger::Info("mserver: removing user %s\n", u.to_str().c_str());
+              LOG(INFO, METASERVER, "mserver: removing user %s\n", u.to_str().c_str());
               exusers.insert(u);
             } else {
               s += u.to_str() + " ";
@@ -99,12 +100,12 @@ struct MetaServer {
             users.erase(u);
             user_timer.erase(Timer::key_t(u.ip));
           }
-          Logger::Info("mserver: users [ %s]\n", s.c_str());
+          LOG(DEBUG, METASERVER, "mserver: users [ %s]\n", s.c_str());
         });
         return !feof(stdin);
       },
       [&](const net::Blob &blob) mutable {
-        Logger::Info("mserver: received package from %s\n", blob.addr.to_str().c_str());
+        LOG(DEBUG, METASERVER, "mserver: received package from %s\n", blob.addr.to_str().c_str());
         // find out if the user already exists
         bool found = users.find(blob.addr) != std::end(users);
         user_timer.set_time(Timer::system_time());
@@ -118,10 +119,10 @@ struct MetaServer {
         >);
         // received hello package
         blob.try_visit_as<pkg::metaserver_hello_struct>([&](const auto hello) mutable {
-          Logger::Info("mserver: recognized as hello package, found=%d\n", found);
+          LOG(DEBUG, METASERVER, "mserver: recognized as hello package, found=%d\n", found);
           if(!found) {
             // add user
-            Logger::Info("mserver: added user %s\n", blob.addr.to_str().c_str());
+            LOG(INFO, METASERVER, "mserver: added user %s\n", blob.addr.to_str().c_str());
             user_timer.set_event(Timer::key_t(blob.addr.ip));
             user_timer.set_timeout(Timer::key_t(blob.addr.ip), Timer::time_t(3.));
             users.insert(blob.addr);
@@ -137,7 +138,7 @@ struct MetaServer {
                   };
                   gameinfo.set_name(it.second);
                   socket.send(net::make_package(blob.addr, gameinfo));
-                  Logger::Info("mserver: randomly sending host info on %s\n", blob.addr.to_str().c_str());
+                  LOG(DEBUG, METASERVER, "mserver: randomly sending host info on %s\n", blob.addr.to_str().c_str());
                   break;
                 }
                 ++i;
@@ -147,7 +148,7 @@ struct MetaServer {
         });
         // respond whether the address is active or not
         blob.try_visit_as<pkg::metaserver_query_struct>([&](const auto query) mutable {
-          Logger::Info("mserver: recognized as query package\n");
+          LOG(DEBUG, METASERVER, "mserver: recognized as query package\n");
           if(!found) {
             return;
           }
@@ -159,14 +160,14 @@ struct MetaServer {
         });
         // received hosting action
         blob.try_visit_as<pkg::metaserver_host_struct>([&](auto host) mutable {
-          Logger::Info("mserver: recognized as hosting struct\n");
+          LOG(DEBUG, METASERVER, "mserver: recognized as hosting struct\n");
           switch(host.action) {
             case pkg::MSAction::HELLO:break;
             case pkg::MSAction::QUERY:break;
             case pkg::MSAction::HOST:
               if(found) {
                 host.name[29] = '\0';
-                Logger::Info("mserver: hosting game name='%s'\n", host.name);
+                LOG(INFO, METASERVER, "mserver: hosting game name='%s'\n", host.name);
                 register_host(blob.addr, host.name);
                 pkg::metaserver_host_response_struct response = {
                   .action = pkg::MSAction::HOST,
@@ -174,7 +175,7 @@ struct MetaServer {
                 };
                 std::string name = host.name;
                 response.set_name(name);
-                Logger::Info("mserver: sending action host host=%s name=%s\n", blob.addr.to_str().c_str(), name.c_str());
+                LOG(INFO, METASERVER, "mserver: sending action host host=%s name=%s\n", blob.addr.to_str().c_str(), name.c_str());
                 for(auto &u : users) {
                   socket.send(net::make_package(u, response));
                 }
@@ -183,9 +184,9 @@ struct MetaServer {
             case pkg::MSAction::UNHOST:
               if(found) {
                 host.name[29] = '\0';
-                Logger::Info("mserver: unhosting game\n");
+                LOG(INFO, METASERVER, "mserver: unhosting game\n");
                 unregister_host(blob.addr);
-                Logger::Info("mserver: sending action unhost host=%s\n", blob.addr.to_str().c_str());
+                LOG(INFO, METASERVER, "mserver: sending action unhost host=%s\n", blob.addr.to_str().c_str());
                 for(auto &u : users) {
                   socket.send(net::make_package(u, (pkg::metaserver_host_response_struct){
                     .action = pkg::MSAction::UNHOST,
@@ -198,7 +199,7 @@ struct MetaServer {
         });
         return !feof(stdin);
     });
-    Logger::Info("mserver: finisned\n");
+    LOG(INFO, METASERVER, "mserver: finisned\n");
   }
 
   // parent lock
@@ -249,6 +250,7 @@ struct MetaServerClient {
   }
 
   static void run(MetaServerClient *client) {
+    TRACE_THREAD("mclient");
     client->socket.listen(
       [&]() mutable {
         if(client->has_quit() || client->has_hosted()) {
@@ -259,12 +261,12 @@ struct MetaServerClient {
         // send hello to the metaserver every second
         client->timer.periodic(EVENT_SEND_HELLO, [&]() mutable {
           if(rand() % 3) {
-            Logger::Info("mclient: sending hello\n");
+            LOG(DEBUG, METASERVER, "mclient: sending hello\n");
             client->send_action((pkg::metaserver_hello_struct){
               .action = pkg::MSAction::HELLO
             });
           } else {
-            Logger::Info("mclient: sending query\n");
+            LOG(DEBUG, METASERVER, "mclient: sending query\n");
             client->send_action((pkg::metaserver_hello_struct){
               .action = pkg::MSAction::QUERY
             });
@@ -287,7 +289,7 @@ struct MetaServerClient {
               for(auto &e2:games) {
                 if(k == m) {
                   auto &addr = e2.first;
-                  Logger::Info("mclient: sending query for host %s\n", addr.to_str().c_str());
+                  LOG(DEBUG, METASERVER, "mclient: sending query for host %s\n", addr.to_str().c_str());
                   client->send_action((pkg::metaserver_query_struct){
                     .action = pkg::MSAction::QUERY,
                     .addr = addr
@@ -319,7 +321,7 @@ struct MetaServerClient {
         // recognize as a query response struct
         blob.try_visit_as<pkg::metaserver_query_response_struct>([&](const auto response) mutable {
           // unregister if no longer marked active
-          Logger::Info("mclient: received query response for %s\n", response.addr.to_str().c_str());
+          LOG(DEBUG, METASERVER, "mclient: received query response for %s\n", response.addr.to_str().c_str());
           if(client->gamelists[blob.addr].find(response.addr) && !response.active) {
             client->unregister_host(blob.addr, response.addr);
           }
@@ -330,11 +332,11 @@ struct MetaServerClient {
             case pkg::MSAction::HELLO:break;
             case pkg::MSAction::QUERY:break;
             case pkg::MSAction::HOST:
-              Logger::Info("mclient: register game host=%s name=%s\n", blob.addr.to_str().c_str(), response.name);
+              LOG(INFO, METASERVER, "mclient: register game host=%s name=%s\n", blob.addr.to_str().c_str(), response.name);
               client->register_host(blob.addr, response.host, response.name);
             break;
             case pkg::MSAction::UNHOST:
-              Logger::Info("mclient: unregister game host=%s\n", blob.addr.to_str().c_str());
+              LOG(INFO, METASERVER, "mclient: unregister game host=%s\n", blob.addr.to_str().c_str());
               client->unregister_host(blob.addr, response.host);
             break;
           }
@@ -389,12 +391,12 @@ struct MetaServerClient {
       .action = pkg::MSAction::HOST
     };
     data.set_name(gamename);
-    Logger::Info("mclient: sending action host name='%s'\n", data.name);
+    LOG(INFO, METASERVER, "mclient: sending action host name='%s'\n", data.name);
     send_action(data);
   }
 
   void action_join(net::Addr host) {
-    Logger::Info("sending action join game host=%s\n", host.to_str().c_str());
+    LOG(INFO, METASERVER, "sending action join game host=%s\n", host.to_str().c_str());
     set_state(State::JOINED);
     std::lock_guard<std::recursive_mutex> guard(lmaker_mtx);
     lobbyMaker = (LobbyMaker){
@@ -434,7 +436,7 @@ struct MetaServerClient {
       s += m.to_str() + " ";
     }
     s += "]";
-    Logger::Info("mclient: started, mserver=%s\n", s.c_str());
+    LOG(INFO, METASERVER, "mclient: started, mserver=%s\n", s.c_str());
     ASSERT(should_stop());
     finalize = false;
     user_thread = std::thread(MetaServerClient::run, this);
@@ -453,7 +455,7 @@ struct MetaServerClient {
       finalize = true;
     }
     user_thread.join();
-    Logger::Info("mclient: finished\n");
+    LOG(INFO, METASERVER, "mclient: finished\n");
   }
 
   ~MetaServerClient()
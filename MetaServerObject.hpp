@@ -5,7 +5,9 @@
 #include "ShaderProgram.hpp"
 #include "MetaServer.hpp"
 #include "Button.hpp"
+#include "LabelCache.hpp"
 #include "StrConst.hpp"
+#include "Trace.hpp"
 
 struct MetaServerObject {
   MetaServerClient &mclient;
@@ -19,12 +21,14 @@ struct MetaServerObject {
 
   C_STRING(texture_name, "assets/button.png");
   ui::Button<texture_name, font_name> button;
+  ui::LabelCache<net::Addr, std::string> game_labels;
 
   MetaServerObject(MetaServerClient &mclient, const std::string &dir):
     mclient(mclient),
     host_button(dir),
     exit_button(dir),
-    button(dir)
+    button(dir),
+    game_labels(*button.font)
   {}
 
   bool is_active() {
@@ -60,16 +64,22 @@ struct MetaServerObject {
 
   template <typename ButtonT, typename F>
   void button_display(ButtonT &btn, F &&func) {
+    button_display(btn, btn.label, func);
+  }
+
+  template <typename ButtonT, typename F>
+  void button_display(ButtonT &btn, ui::Text &label, F &&func) {
     btn.mouse(cursorPosition.x, cursorPosition.y);
     if(clicked && (btn.region.contains(cursorPosition) || btn.state != ButtonT::DEFAULT_STATE)) {
       btn.mouse_click(click_button, click_action);
       clicked = false;
     }
     btn.action_on_click(func);
-    btn.display();
+    btn.display(label);
   }
 
   void display() {
+    TRACE_SCOPE("MetaServerObject: display");
     if(!is_active())return;
     button_display(host_button, [&]() mutable {
       mclient.action_host("the game");
@@ -95,15 +105,19 @@ struct MetaServerObject {
     for(auto &g : glist.games) {
       auto &host = g.first;
       auto &name = g.second;
-      button.label.set_text(host.to_str() + " : " + name);
-      button_display(button, [&]() mutable {
+      ui::Text &label = game_labels.get(host, name, [&]() {
+        return host.to_str() + " : " + name;
+      });
+      button_display(button, label, [&]() mutable {
         mclient.action_join(g.first);
       });
       button.region.ys += .1;
     }
+    game_labels.prune();
   }
 
   void clear() {
+    game_labels.clear();
     button.clear();
     exit_button.clear();
     host_button.clear();
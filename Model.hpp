@@ -14,42 +14,134 @@
 #include "ShaderAttrib.hpp"
 #include "VertexArray.hpp"
 #include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
 #include "Texture.hpp"
 #include "ImageLoader.hpp"
+#include "AssetPack.hpp"
+#include "Assets.hpp"
 
-unsigned int TextureFromFile(const char *texture_path, const std::string &directory, bool gamma = false);
+GLuint TextureFromFile(const std::string &filename, const img::Image *image=nullptr);
+
+// an image file as a mipmapped texture, shared through asset::Registry by
+// every model and object that uses the file
+struct TextureFile {
+  std::string filename;
+  GLuint id = 0;
+  // decoded by load(), unless the asset pack has it
+  img::Image *image = nullptr;
+
+  TextureFile(const std::string &filename):
+    filename(filename)
+  {}
+
+  void load() {
+    image = gl::Texture::decode(filename);
+  }
+
+  bool upload() {
+    id = TextureFromFile(filename, image);
+    delete image;
+    image = nullptr;
+    return true;
+  }
+
+  void init() {
+    load();
+    upload();
+  }
+
+  void clear() {
+    delete image;
+    image = nullptr;
+    gl::Texture::clear(id);
+    id = 0;
+  }
+};
 
 struct Model {
   std::string model_path;
-  std::vector<ModelTexture> textures_loaded;
+  std::vector<asset::Handle<TextureFile>> textures_loaded;
   std::vector<Mesh> meshes;
   std::string directory;
   bool gammaCorrection;
+  // slices of upload() done, and whether the meshes have the ids of their
+  // textures yet
+  size_t no_slices = 0;
+  bool has_textures = false;
 
   Model(std::string model_path, bool gamma=false):
     model_path(model_path), gammaCorrection(gamma)
   {}
 
-  void init() {
-    Logger::Info("Started loading model %s\n", model_path.c_str());
+  // meshes and the paths of their textures, without touching GL, from the
+  // asset pack or else through assimp
+  void load() {
+    directory = model_path.substr(0, model_path.find_last_of('/'));
+    if(load_packed())return;
+    LOG(INFO, GRAPHICS, "Started loading model %s\n", model_path.c_str());
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(model_path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const aiScene *scene = importer.ReadFile(model_path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
     if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
       /* Logger::Error("msg=%s\n", importer.GetErrorString().c_str()); */
       std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
       return;
     }
-    directory = model_path.substr(0, model_path.find_last_of('/'));
     processNode(scene->mRootNode, scene);
-    Logger::Info("Finished loading model %s\n", model_path.c_str());
+    LOG(INFO, GRAPHICS, "Finished loading model %s\n", model_path.c_str());
+  }
+
+  bool load_packed() {
+    const AssetPack::Entry *e = AssetPack::find(model_path, AssetPack::Type::MODEL);
+    if(e == nullptr)return false;
+    const auto *header = AssetPack::at<AssetPack::ModelHeader>(e);
+    const auto *mesh_headers = AssetPack::at<AssetPack::MeshHeader>(e, header->meshes_offset);
+    for(uint32_t i = 0; i < header->no_meshes; ++i) {
+      const AssetPack::MeshHeader &mh = mesh_headers[i];
+      const auto *mesh_textures = AssetPack::at<AssetPack::MeshTexture>(e, mh.textures_offset);
+      std::vector<ModelTexture> textures;
+      for(uint32_t j = 0; j < mh.no_textures; ++j) {
+        textures.push_back({0, mesh_textures[j].type, mesh_textures[j].path});
+      }
+      meshes.emplace_back(AssetPack::at<PackedVertex>(e, mh.vertices_offset), mh.no_vertices,
+                          AssetPack::at<void>(e, mh.indices_offset), mh.no_indices,
+                          mh.index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                          textures);
+    }
+    LOG(INFO, GRAPHICS, "Loaded model %s from the asset pack\n", model_path.c_str());
+    return true;
+  }
+
+  void init() {
+    load();
+    for(auto &m : meshes) {
+      for(auto &t : m.textures) {
+        texture(t.texture_path).init();
+      }
+      m.init();
+    }
+    no_slices = meshes.size() + 1;
+    textures_ready();
+  }
+
+  // after load(), on the render thread: the first slice hands the textures
+  // to the loader, then a mesh a slice
+  bool upload() {
+    if(no_slices == 0) {
+      for(auto &m : meshes) {
+        for(auto &t : m.textures) {
+          texture(t.texture_path).load_async();
+        }
+      }
+    } else {
+      meshes[no_slices - 1].init();
+    }
+    return ++no_slices > meshes.size();
   }
 
   void processNode(aiNode *node, const aiScene *scene) {
     for(GLuint i = 0; i < node->mNumMeshes; ++i) {
       aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-      auto m = processMesh(mesh, scene);
-      m.init();
-      meshes.push_back(m);
+      meshes.push_back(processMesh(mesh, scene));
     }
     for(GLuint i = 0; i < node->mNumChildren; ++i) {
       processNode(node->mChildren[i], scene);
@@ -77,7 +169,7 @@ struct Model {
       ModelVertex vertex;
 
       vertex.pos = to_vec3_xyz(mesh->mVertices[i]);
-      vertex.nrm = to_vec3_xyz(mesh->mNormals[i]);
+      vertex.nrm = mesh->mNormals ? to_vec3_xyz(mesh->mNormals[i]) : glm::vec3(0.f, 0.f, 1.f);
       // texture coordinates
       if(mesh->mTextureCoords[0]) {
         // does the mesh contain texture coordinates?
@@ -87,8 +179,14 @@ struct Model {
       } else {
         vertex.txcoords = glm::vec2(0.0f, 0.0f);
       }
-      vertex.tangent = to_vec3_xyz(mesh->mTangents[i]);
-      vertex.bitan = to_vec3_xyz(mesh->mBitangents[i]);
+      // no tangent space without texture coordinates
+      if(mesh->mTangents) {
+        vertex.tangent = to_vec3_xyz(mesh->mTangents[i]);
+        vertex.bitan = to_vec3_xyz(mesh->mBitangents[i]);
+      } else {
+        vertex.tangent = glm::vec3(1.f, 0.f, 0.f);
+        vertex.bitan = glm::vec3(0.f, 1.f, 0.f);
+      }
 
       vertices.push_back(vertex);
     }
@@ -122,8 +220,10 @@ struct Model {
     std::vector<ModelTexture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height"s);
     textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-    // return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
+    // return a mesh object created from the extracted mesh data, packed and
+    // reordered for the vertex cache
+    std::vector<PackedVertex> packed = mesh::optimize(vertices, indices);
+    return Mesh(packed, indices, textures);
   }
 
   std::vector<ModelTexture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName) {
@@ -131,28 +231,41 @@ struct Model {
     for(GLuint i = 0; i < mat->GetTextureCount(type); i++) {
       aiString str;
       mat->GetTexture(type, i, &str);
-      // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-      bool skip = false;
-      for(GLuint j = 0; j < textures_loaded.size(); j++) {
-        if(std::strcmp(textures_loaded[j].texture_path.data(), str.C_Str()) == 0) {
-          textures.push_back(textures_loaded[j]);
-          skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-          break;
-        }
-      }
-      if(!skip) {
-        // if texture hasn't been loaded already, load it
-        ModelTexture texture;
-        texture.id = TextureFromFile(str.C_Str(), this->directory);
-        texture.type = typeName;
-        texture.texture_path = str.C_Str();
-        textures.push_back(texture);
-        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-      }
+      ModelTexture texture;
+      texture.id = 0;
+      texture.type = typeName;
+      texture.texture_path = str.C_Str();
+      textures.push_back(texture);
     }
     return textures;
   }
 
+  // shared with the other models using the file, one user per model
+  asset::Handle<TextureFile> &texture(const std::string &texture_path) {
+    const std::string filename = directory + '/' + texture_path;
+    for(auto &t : textures_loaded) {
+      if(t.key() == filename)return t;
+    }
+    textures_loaded.push_back(asset::Registry<TextureFile>::load(filename));
+    return textures_loaded.back();
+  }
+
+  // the textures may still be loading when the meshes are done, the meshes
+  // get their ids once all of them are uploaded
+  bool textures_ready() {
+    if(has_textures)return true;
+    for(const auto &t : textures_loaded) {
+      if(!t.ready())return false;
+    }
+    for(auto &m : meshes) {
+      for(auto &t : m.textures) {
+        t.id = texture(t.texture_path)->id;
+      }
+    }
+    has_textures = true;
+    return true;
+  }
+
   template <typename... ShaderTs>
   void display(gl::ShaderProgram<ShaderTs...> &program) {
     for(GLuint i = 0; i < meshes.size(); ++i) {
@@ -160,35 +273,66 @@ struct Model {
     }
   }
 
+  void set_instance_buffer(GLuint location, GLuint vbo, size_t offset=0) {
+    for(auto &m : meshes) {
+      m.set_instance_buffer(location, vbo, offset);
+    }
+  }
+
+  template <typename... ShaderTs>
+  void display_instanced(gl::ShaderProgram<ShaderTs...> &program, size_t no_instances) {
+    for(GLuint i = 0; i < meshes.size(); ++i) {
+      meshes[i].display_instanced(program, no_instances);
+    }
+  }
+
+  template <typename... ShaderTs>
+  void submit(gl::RenderQueue &queue, const gl::RenderQueue::Packet &base, gl::ShaderProgram<ShaderTs...> &program, size_t no_instances=0, const Variant *variant=nullptr) {
+    if(!textures_ready())return;
+    for(GLuint i = 0; i < meshes.size(); ++i) {
+      meshes[i].submit(queue, base, program, no_instances, variant);
+    }
+  }
+
   void clear() {
     for(auto &m : meshes) {
       m.clear();
     }
+    for(auto &t : textures_loaded) {
+      t.clear();
+    }
+    textures_loaded.clear();
+    no_slices = 0;
+    has_textures = false;
   }
 };
 
-GLuint TextureFromFile(const char *texture_path, const std::string &directory, bool gamma) {
-  std::string filename = std::string(texture_path);
-  filename = directory + '/' + filename;
-
+// from the image if it is decoded already, else from the asset pack or the
+// file
+GLuint TextureFromFile(const std::string &filename, const img::Image *image) {
   GLuint textureID;
   glGenTextures(1, &textureID); GLERROR
 
   int width, height, nrComponents;
-  sys::File file(filename.c_str());
-  img::Image *image = img::load_image(file);
   GLenum format;
 
-  glBindTexture(GL_TEXTURE_2D, textureID); GLERROR
-  GLenum pixel_format = gl::Texture::get_gl_pixel_format(image->format);
-  glTexImage2D(GL_TEXTURE_2D, 0, pixel_format, image->width, image->height, 0, pixel_format, GL_UNSIGNED_BYTE, image->data); GLERROR
-  glGenerateMipmap(GL_TEXTURE_2D); GLERROR
+  gl::Texture::bind(textureID);
+  if(image != nullptr || !gl::Texture::load_packed(filename)) {
+    img::Image *decoded = nullptr;
+    if(image == nullptr) {
+      sys::File file(filename.c_str());
+      image = decoded = img::load_image(file);
+    }
+    GLenum pixel_format = gl::Texture::get_gl_pixel_format(image->format);
+    glTexImage2D(GL_TEXTURE_2D, 0, pixel_format, image->width, image->height, 0, pixel_format, GL_UNSIGNED_BYTE, image->data); GLERROR
+    glGenerateMipmap(GL_TEXTURE_2D); GLERROR
+    delete decoded;
+  }
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); GLERROR
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); GLERROR
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); GLERROR
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); GLERROR
 
-  delete image;
   return textureID;
 }
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <cstring>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <ctime>
 
 #include <sys/socket.h>
@@ -24,6 +26,8 @@
 #include <optional>
 #include <type_traits>
 #include <mutex>
+#include <chrono>
+#include <algorithm>
 
 #ifndef TERMINATE
 #include "Debug.hpp"
@@ -32,6 +36,8 @@
 #include "Optimizations.hpp"
 #endif
 #endif
+#include "Logger.hpp"
+#include "Trace.hpp"
 
 namespace net {
 
@@ -89,6 +95,31 @@ struct Addr {
   }
 } ATTRIB_PACKED;
 
+// parses "host:port", where host is a name or a dotted ipv4 address
+std::optional<Addr> resolve(const std::string &hostport) {
+  size_t colon = hostport.rfind(':');
+  if(colon == std::string::npos) {
+    return std::nullopt;
+  }
+  const std::string host = hostport.substr(0, colon);
+  const int port = atoi(hostport.c_str() + colon + 1);
+  if(port <= 0 || port > 65535) {
+    return std::nullopt;
+  }
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo *result = nullptr;
+  if(getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+    return std::nullopt;
+  }
+  sockaddr_in saddr = *(sockaddr_in *)result->ai_addr;
+  freeaddrinfo(result);
+  saddr.sin_port = htons(port);
+  return Addr(saddr);
+}
+
 template <typename T>
 struct Package {
   Addr addr;
@@ -171,6 +202,231 @@ struct Blob {
   }
 };
 
+// every datagram ends with a trailer, which the receiver strips before the
+// payload is visited. the echo of the last stamp received from the peer and
+// the time it was held back give the round trip without synchronized clocks
+struct trailer_struct {
+  static constexpr uint32_t NO_ECHO = UINT32_MAX;
+  uint32_t seq;
+  uint32_t stamp; // microseconds, sender clock
+  uint32_t echo_stamp;
+  uint32_t echo_delay; // microseconds, NO_ECHO if nothing was received yet
+} ATTRIB_PACKED;
+
+// link counters of a single peer. times are in milliseconds, except for the
+// stalled time in seconds
+struct PeerStats {
+  Addr addr;
+  uint64_t packets_in = 0, bytes_in = 0;
+  uint64_t packets_out = 0, bytes_out = 0;
+  uint64_t no_out_of_order = 0;
+  uint64_t no_sequenced = 0; // received since the peer (re)started
+  uint32_t first_seq = 0, max_seq = 0;
+  float rtt = -1, rtt_min = -1, rtt_max = -1;
+  float jitter = 0;
+  double stalled = 0;
+
+  // sender state
+  uint32_t next_seq = 1;
+  bool has_stamp = false;
+  uint32_t last_stamp = 0;
+  uint64_t last_stamp_time = 0;
+  // receiver state
+  bool has_transit = false;
+  int32_t last_transit = 0;
+  uint64_t last_active = 0;
+  uint64_t dumped_bytes_in = 0, dumped_bytes_out = 0;
+
+  PeerStats()
+  {}
+
+  explicit PeerStats(Addr addr):
+    addr(addr)
+  {}
+
+  uint64_t expected() const {
+    return (no_sequenced == 0) ? 0 : uint64_t(max_seq - first_seq) + 1;
+  }
+
+  uint64_t lost() const {
+    return std::max<int64_t>(int64_t(expected()) - int64_t(no_sequenced), 0);
+  }
+
+  float loss_rate() const {
+    return (expected() == 0) ? 0.f : float(lost()) / expected();
+  }
+
+  std::string to_str() const {
+    char s[160];
+    snprintf(s, sizeof(s), "%s: rtt %.1fms (%.1f-%.1f), jitter %.1fms, loss %.2f%%, %lu out of order, stalled %.2fs",
+      addr.to_str().c_str(), rtt, rtt_min, rtt_max, jitter, loss_rate() * 100, no_out_of_order, stalled);
+    return s;
+  }
+};
+
+// per-peer counters of a socket, kept in a flat table which is scanned
+// linearly, a socket only talks to a handful of peers at a time. not
+// synchronized, the owning socket locks around it
+struct Telemetry {
+  static constexpr size_t MAX_PEERS = 256;
+  static constexpr uint64_t PEER_TIMEOUT = 60e6;
+  // a peer whose sequence numbers go back this far has restarted
+  static constexpr uint32_t MAX_REORDERING = 1024;
+
+  std::vector<PeerStats> peers;
+  size_t last_peer = 0;
+
+  std::string output = "";
+  uint64_t dump_interval = 5e6;
+  uint64_t last_dump = 0;
+
+  Telemetry()
+  {}
+
+  static uint64_t now() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  PeerStats &peer(const Addr &addr, uint64_t time) {
+    if(last_peer < peers.size() && peers[last_peer].addr == addr) {
+      return peers[last_peer];
+    }
+    for(size_t i = 0; i < peers.size(); ++i) {
+      if(peers[i].addr == addr) {
+        last_peer = i;
+        return peers[i];
+      }
+    }
+    if(peers.size() < MAX_PEERS) {
+      last_peer = peers.size();
+      peers.emplace_back(addr);
+    } else {
+      // replace the peer which has been quiet for the longest time
+      last_peer = std::min_element(peers.begin(), peers.end(), [](const PeerStats &a, const PeerStats &b) {
+        return a.last_active < b.last_active;
+      }) - peers.begin();
+      peers[last_peer] = PeerStats(addr);
+    }
+    peers[last_peer].last_active = time;
+    return peers[last_peer];
+  }
+
+  trailer_struct on_send(const Addr &addr, size_t bytes) {
+    const uint64_t time = now();
+    PeerStats &p = peer(addr, time);
+    ++p.packets_out;
+    p.bytes_out += bytes;
+    trailer_struct trailer = {
+      .seq = p.next_seq++,
+      .stamp = uint32_t(time),
+      .echo_stamp = 0,
+      .echo_delay = trailer_struct::NO_ECHO
+    };
+    if(p.has_stamp) {
+      trailer.echo_stamp = p.last_stamp;
+      trailer.echo_delay = uint32_t(time - p.last_stamp_time);
+    }
+    return trailer;
+  }
+
+  void on_receive(const Addr &addr, size_t bytes, const trailer_struct &trailer) {
+    const uint64_t time = now();
+    PeerStats &p = peer(addr, time);
+    p.last_active = time;
+    if(trailer.seq < p.max_seq && p.max_seq - trailer.seq > MAX_REORDERING) {
+      p.no_sequenced = 0;
+      p.has_transit = false;
+    }
+    ++p.packets_in;
+    p.bytes_in += bytes;
+    if(++p.no_sequenced == 1) {
+      p.first_seq = p.max_seq = trailer.seq;
+    } else if(trailer.seq < p.max_seq) {
+      ++p.no_out_of_order;
+    } else {
+      p.max_seq = trailer.seq;
+    }
+    p.has_stamp = true;
+    p.last_stamp = trailer.stamp;
+    p.last_stamp_time = time;
+    if(trailer.echo_delay != trailer_struct::NO_ECHO) {
+      const int32_t rtt_us = int32_t(uint32_t(time) - trailer.echo_stamp - trailer.echo_delay);
+      if(rtt_us >= 0) {
+        const float rtt = rtt_us * 1e-3f;
+        p.rtt = (p.rtt < 0) ? rtt : p.rtt + (rtt - p.rtt) / 8;
+        p.rtt_min = (p.rtt_min < 0) ? rtt : std::min(p.rtt_min, rtt);
+        p.rtt_max = std::max(p.rtt_max, rtt);
+      }
+    }
+    // interarrival jitter as in rfc 3550, the clock offset cancels out
+    const int32_t transit = int32_t(uint32_t(time) - trailer.stamp);
+    if(p.has_transit) {
+      const float d = std::abs(transit - p.last_transit) * 1e-3f;
+      p.jitter += (d - p.jitter) / 16;
+    }
+    p.has_transit = true;
+    p.last_transit = transit;
+  }
+
+  void add_stall(const Addr &addr, double seconds) {
+    peer(addr, now()).stalled += seconds;
+  }
+
+  std::optional<PeerStats> find(const Addr &addr) const {
+    for(const auto &p : peers) {
+      if(p.addr == addr) {
+        return p;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void set_output(const std::string &filename, double interval) {
+    output = filename;
+    dump_interval = interval * 1e6;
+    last_dump = now();
+    FILE *fp = fopen(output.c_str(), "w");
+    if(fp == nullptr) {
+      LOG(ERROR, NET, "telemetry: unable to open '%s'\n", output.c_str());
+      output = "";
+      return;
+    }
+    fprintf(fp, "time,peer,packets_in,bytes_in,packets_out,bytes_out,kbps_in,kbps_out,rtt,rtt_min,rtt_max,jitter,loss,out_of_order,stalled\n");
+    fclose(fp);
+  }
+
+  bool dump_due() const {
+    return !output.empty() && now() - last_dump >= dump_interval;
+  }
+
+  // appends a line per peer with the rates since the previous dump, and
+  // forgets the peers which went quiet
+  void dump() {
+    const uint64_t time = now();
+    const double interval = (time - last_dump) * 1e-6;
+    FILE *fp = fopen(output.c_str(), "a");
+    if(fp == nullptr) {
+      LOG(ERROR, NET, "telemetry: unable to open '%s'\n", output.c_str());
+      return;
+    }
+    for(auto &p : peers) {
+      fprintf(fp, "%.3f,%s,%lu,%lu,%lu,%lu,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.4f,%lu,%.3f\n",
+        time * 1e-6, p.addr.to_str().c_str(),
+        p.packets_in, p.bytes_in, p.packets_out, p.bytes_out,
+        (p.bytes_in - p.dumped_bytes_in) * 8e-3 / interval, (p.bytes_out - p.dumped_bytes_out) * 8e-3 / interval,
+        p.rtt, p.rtt_min, p.rtt_max, p.jitter, p.loss_rate(), p.no_out_of_order, p.stalled);
+      p.dumped_bytes_in = p.bytes_in, p.dumped_bytes_out = p.bytes_out;
+    }
+    fclose(fp);
+    last_dump = time;
+    peers.erase(std::remove_if(peers.begin(), peers.end(), [&](const PeerStats &p) {
+      return time - p.last_active > PEER_TIMEOUT;
+    }), peers.end());
+    last_peer = 0;
+  }
+};
+
 enum class SocketType {
   ICMP,
   UDP,
@@ -285,6 +541,7 @@ class Socket<SocketType::UDP> {
   int handle_;
   port_t port_;
   std::mutex mtx;
+  Telemetry telemetry;
 public:
   Socket(port_t port):
     port_(port)
@@ -324,9 +581,15 @@ public:
 
     sockaddr_in address = package.addr;
 
-    int sent_bytes = sendto(handle_, &package.data, sizeof(T), 0, (sockaddr *) &address, sizeof(sockaddr_in));
+    constexpr size_t size = sizeof(T) + sizeof(trailer_struct);
+    uint8_t data[size];
+    const trailer_struct trailer = telemetry.on_send(package.addr, size);
+    memcpy(data, &package.data, sizeof(T));
+    memcpy(data + sizeof(T), &trailer, sizeof(trailer_struct));
 
-    if(sent_bytes != sizeof(T)) {
+    int sent_bytes = sendto(handle_, data, size, 0, (sockaddr *) &address, sizeof(sockaddr_in));
+
+    if(sent_bytes != int(size)) {
       std::cout << package.addr.to_str() << std::endl;
       perror("error");
       TERMINATE("Can't send packet\n");
@@ -339,20 +602,54 @@ public:
     socklen_t saddr_from_length = sizeof(saddr_from);
 
     Blob blob;
-    blob.resize(MAX_PACKET_SIZE);
+    blob.resize(MAX_PACKET_SIZE + sizeof(trailer_struct));
 
-    int received_bytes = recvfrom(handle_, blob.data(), MAX_PACKET_SIZE, 0, (sockaddr *)&saddr_from, &saddr_from_length);
+    int received_bytes = recvfrom(handle_, blob.data(), blob.size(), 0, (sockaddr *)&saddr_from, &saddr_from_length);
 
-    if(received_bytes <= 0) {
+    if(received_bytes <= int(sizeof(trailer_struct))) {
       return std::optional<Blob>();
     }
 
-    blob.resize(received_bytes);
+    trailer_struct trailer;
+    const size_t size = received_bytes - sizeof(trailer_struct);
+    memcpy(&trailer, (const uint8_t *)blob.data() + size, sizeof(trailer_struct));
+    blob.resize(size);
     blob.addr = Addr(saddr_from);
+    telemetry.on_receive(blob.addr, received_bytes, trailer);
 
     return blob;
   }
 
+  std::vector<PeerStats> stats() {
+    std::lock_guard<std::mutex> guard(mtx);
+    return telemetry.peers;
+  }
+
+  std::optional<PeerStats> stats(const Addr &addr) {
+    std::lock_guard<std::mutex> guard(mtx);
+    return telemetry.find(addr);
+  }
+
+  // time the game could not advance for the lack of packets from addr
+  void add_stall(const Addr &addr, double seconds) {
+    std::lock_guard<std::mutex> guard(mtx);
+    telemetry.add_stall(addr, seconds);
+  }
+
+  // the counters are appended to filename every interval seconds, from
+  // whichever thread is listening
+  void set_stats_output(const std::string &filename, double interval=5.) {
+    std::lock_guard<std::mutex> guard(mtx);
+    telemetry.set_output(filename, interval);
+  }
+
+  void dump_stats() {
+    std::lock_guard<std::mutex> guard(mtx);
+    if(telemetry.dump_due()) {
+      telemetry.dump();
+    }
+  }
+
   constexpr port_t port() const {
     return port_;
   }
@@ -365,7 +662,9 @@ public:
       if(!break_func()) {
         break;
       }
+      dump_stats();
       if((opt_blob = receive()).has_value()) {
+        TRACE_SCOPE("socket: handle packet");
         cond = idle(*opt_blob);
       }
     }
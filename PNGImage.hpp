@@ -47,7 +47,7 @@ struct PNGImage : public Image {
     }
 
     if(setjmp(png_jmpbuf(png_ptr))) {
-      Logger::Error("png: error during init_io\n");
+      LOG(ERROR, GRAPHICS, "png: error during init_io\n");
     }
 
     png_init_io(png_ptr, fp);
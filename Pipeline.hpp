@@ -25,7 +25,7 @@ struct Pipeline {
 
   template <typename... ShaderTs>
   void use(gl::ShaderProgram<ShaderTs...> &program) {
-    glUseProgram(program.id()); GLERROR
+    gl::State::use_program(program.id());
   }
 
   void clear() {
@@ -10,6 +10,8 @@
 #include "ShaderUniform.hpp"
 #include "ShaderAttrib.hpp"
 #include "Texture.hpp"
+#include "RenderQueue.hpp"
+#include "Trace.hpp"
 
 struct PitchObject {
   std::string dir;
@@ -60,7 +62,7 @@ struct PitchObject {
     vao.set_access(attrVertex, 0, 0);
     ShaderProgram::init(program, vao);
 
-    grassTx.init(sys::Path(dir) / sys::Path("assets"s) / sys::Path("grass.png"s));
+    grassTx.init_async(sys::Path(dir) / sys::Path("assets"s) / sys::Path("grass.png"s));
     grassTx.uSampler.set_id(program.id());
     uTransform.set_id(program.id());
   }
@@ -79,24 +81,24 @@ struct PitchObject {
     return Region(glm::vec2(0, playable.xs.y), glm::vec2(playable.ys.x, playable.ys.y));
   }
 
-  void display(Camera &cam) {
-    ShaderProgram::use(program);
-
-    if(transform.has_changed || cam.has_changed) {
-      matrix = cam.get_matrix() * transform.get_matrix();
-      uTransform.set_data(matrix);
-
+  void submit(gl::RenderQueue &queue, Camera &cam) {
+    TRACE_SCOPE("PitchObject: submit");
+    if(transform.has_changed) {
+      matrix = transform.get_matrix();
       transform.has_changed = false;
     }
 
-    gl::Texture::set_active(0);
-    grassTx.bind();
-    grassTx.set_data(0);
-
-    VertexArray::draw<GL_TRIANGLES>(vao);
-
-    gl::Texture::unbind();
-    ShaderProgram::unuse();
+    // the camera comes from the frame uniforms
+    gl::RenderQueue::Packet &p = queue.add(gl::RenderQueue::Pass::GROUND);
+    p.program = program.id();
+    p.add_texture(grassTx.id());
+    p.vertex_array = vao.id();
+    p.transform_location = uTransform.id();
+    p.transform = matrix;
+    p.draw = [this]() mutable -> void {
+      grassTx.set_data(0);
+      VertexArray::draw<GL_TRIANGLES>(vao);
+    };
   }
 
   void clear() {
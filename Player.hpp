@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Timer.hpp"
+#include "Scheduler.hpp"
 #include "Ball.hpp"
 #include "Unit.hpp"
 
@@ -16,13 +17,27 @@ struct Player {
   Timer timer;
   bool team;
   int playerId;
-  static constexpr int
-    TIME_DISPOSSESSED = 0,
-    TIME_GOT_BALL = 1,
-    TIME_OF_LAST_JUMP = 2,
-    TIME_OF_LAST_SLIDE = 3,
-    TIME_LAST_SLOWN_DOWN = 4,
-    TIME_OF_LAST_PASS = 5;
+  // cooldowns end with an event of the soccer scheduler, which flips the
+  // state flags below
+  enum Event : Scheduler::key_t {
+    JUMP_READY,
+    POSSESSION_UNLOCKED,
+    PASS_READY,
+    SLIDE_SLOWS_DOWN,
+    SLIDE_ENDS,
+    SLOWDOWN_ENDS,
+    NO_EVENTS
+  };
+  enum class Slide : int8_t {
+    NONE, FAST, SLOWDOWN
+  };
+  Scheduler *scheduler = nullptr;
+  Scheduler::key_t first_key = 0;
+  bool jump_ready = false;
+  bool possession_locked = true;
+  bool pass_ready = false;
+  bool slown_down = false;
+  Slide slide = Slide::NONE;
   static constexpr Timer::time_t CANT_HOLD_BALL_DISPOSSESS = 1.45;
   static constexpr Timer::time_t CANT_HOLD_BALL_SHOT = 0.9;
   float tallness = Unit::GAUGE * 100;
@@ -45,14 +60,37 @@ struct Player {
   const float slide_slowdown_speed = .5 * running_speed;
   const float slide_cooldown = slide_duration + slide_slowdown_duration;
 
-  void set_timer() {
-    timer.set_event(TIME_GOT_BALL);
-    timer.set_event(TIME_DISPOSSESSED);
-    timer.set_timeout(TIME_OF_LAST_JUMP, jump_cooldown);
-    timer.set_timeout(TIME_OF_LAST_SLIDE, slide_cooldown);
-    timer.set_timeout(TIME_LAST_SLOWN_DOWN, SLOWDOWN_SHOT);
-    timer.set_timeout(TIME_OF_LAST_PASS, pass_cooldown);
-    /* timer.dump_times(); */
+  // every cooldown starts running at the kick-off
+  void set_timer(Scheduler &sched, Scheduler::key_t key) {
+    scheduler = &sched;
+    first_key = key;
+    possession_locked = true;
+    schedule(POSSESSION_UNLOCKED, 0.);
+    jump_ready = false;
+    schedule(JUMP_READY, jump_cooldown);
+    slide = Slide::FAST;
+    schedule(SLIDE_SLOWS_DOWN, slide_duration);
+    schedule(SLIDE_ENDS, slide_cooldown);
+    slown_down = true;
+    schedule(SLOWDOWN_ENDS, SLOWDOWN_SHOT);
+    pass_ready = false;
+    schedule(PASS_READY, pass_cooldown);
+  }
+
+  void schedule(Event event, Timer::time_t delay) {
+    scheduler->schedule_in(first_key + event, delay);
+  }
+
+  void on_event(Event event) {
+    switch(event) {
+      case JUMP_READY: jump_ready = true; break;
+      case POSSESSION_UNLOCKED: possession_locked = false; break;
+      case PASS_READY: pass_ready = true; break;
+      case SLIDE_SLOWS_DOWN: slide = Slide::SLOWDOWN; break;
+      case SLIDE_ENDS: slide = Slide::NONE; break;
+      case SLOWDOWN_ENDS: slown_down = false; break;
+      case NO_EVENTS:break;
+    }
   }
 
   int id() const { return playerId; }
@@ -95,7 +133,7 @@ struct Player {
   }
 
   bool can_jump() const {
-    return timer.timed_out(TIME_OF_LAST_JUMP);
+    return jump_ready;
   }
 
   bool is_jumping() const {
@@ -112,7 +150,8 @@ struct Player {
 
   void jump(float vspeed) {
     if(!can_jump())return;
-    timer.set_event(TIME_OF_LAST_JUMP);
+    jump_ready = false;
+    schedule(JUMP_READY, jump_cooldown);
     if(is_sliding() || is_slown_down())return;
     ASSERT(!is_in_air);
     is_in_air = true;
@@ -126,20 +165,19 @@ struct Player {
   }
 
   bool can_possess() const {
-    return timer.timed_out(TIME_DISPOSSESSED);
+    return !possession_locked;
   }
 
   void timestamp_got_ball(Ball &ball) {
     has_ball = true;
-    timer.set_event(TIME_GOT_BALL);
     ball.timestamp_set_owner(playerId);
   }
 
   void timestamp_dispossess(Ball &ball, float lock_for) {
     ASSERT(is_owner(ball));
     has_ball = false;
-    timer.set_event(TIME_DISPOSSESSED);
-    timer.set_timeout(TIME_DISPOSSESSED, lock_for);
+    possession_locked = true;
+    schedule(POSSESSION_UNLOCKED, lock_for);
     ball.timestamp_set_owner(Ball::NO_OWNER);
   }
 
@@ -161,7 +199,6 @@ struct Player {
     )
     {
       if(id() == 0) {
-        /* printf("control: elapsed %f, return NAN\n", timer.elapsed(TIME_DISPOSSESSED)); */
         /* printf("control: conditions %d %d %d [%f %f] %d %d\n", */
         /*   !ball.can_interact(), */
         /*   !can_possess(), */
@@ -194,45 +231,48 @@ struct Player {
   }
 
   bool can_pass() const {
-    return timer.timed_out(TIME_OF_LAST_PASS);
+    return pass_ready;
   }
 
   void timestamp_passed() {
     if(!can_pass())return;
-    timer.set_event(TIME_OF_LAST_PASS);
+    pass_ready = false;
+    schedule(PASS_READY, pass_cooldown);
   }
 
   bool can_slide() {
-    return !is_jumping() && timer.timed_out(TIME_OF_LAST_SLIDE);
+    return !is_jumping() && slide == Slide::NONE;
   }
 
   bool is_sliding() const {
-    return !timer.timed_out(TIME_OF_LAST_SLIDE);
+    return slide != Slide::NONE;
   }
 
   bool is_sliding_fast() const {
-    return timer.elapsed(TIME_OF_LAST_SLIDE) < slide_duration;
+    return slide == Slide::FAST;
   }
 
   bool is_sliding_slowndown() const {
-    return is_sliding() && !is_sliding_fast();
+    return slide == Slide::SLOWDOWN;
   }
 
   void timestamp_slide() {
     ASSERT(!has_ball);
     if(!can_slide())return;
-    timer.set_event(TIME_OF_LAST_SLIDE);
+    slide = Slide::FAST;
+    schedule(SLIDE_SLOWS_DOWN, slide_duration);
+    schedule(SLIDE_ENDS, slide_cooldown);
   }
 
   void slowdown(float time) {
   }
 
   bool is_slown_down() const {
-    return !timer.timed_out(TIME_LAST_SLOWN_DOWN);
+    return slown_down;
   }
 
   void timestamp_slowdown(Timer::time_t dur=SLOWDOWN_SLID) {
-    timer.set_event(TIME_LAST_SLOWN_DOWN);
-    timer.set_timeout(TIME_LAST_SLOWN_DOWN, dur);
+    slown_down = true;
+    schedule(SLOWDOWN_ENDS, dur);
   }
 };
@@ -1,40 +1,49 @@
 #pragma once
 
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
 #include "Transformation.hpp"
 #include "Camera.hpp"
 #include "Model.hpp"
 #include "Shadow.hpp"
-#include "Sprite.hpp"
+#include "Assets.hpp"
 #include "StrConst.hpp"
 #include "Player.hpp"
+#include "RenderQueue.hpp"
+#include "StreamBuffer.hpp"
 
 #include "File.hpp"
+#include "Trace.hpp"
 
+// all players at once: the model matrices of each team are streamed for the
+// frame and every mesh of the model is drawn with one instanced call per
+// team, the shadows of all players with another one. both teams share the
+// geometry, the red one draws with its own skin in place of the model's
+// blue one
 struct PlayerObject {
   std::string dir;
 
-  glm::mat4 matrix;
   glm::mat4 extra_rotate;
   Transformation transform;
 
-  class RedPlayer; class BluePlayer;
-
-  Sprite<Model, RedPlayer> *playerModelRed;
-  Sprite<Model, BluePlayer> *playerModelBlue;
-  gl::Uniform<gl::UniformType::MAT4> uTransform;
+  asset::Handle<Model> playerModel;
+  asset::Handle<TextureFile> skinRed;
+  Variant variantRed, variantBlue;
   gl::ShaderProgram<
     gl::VertexShader,
     gl::FragmentShader
   > program;
   Shadow shadow;
+  std::vector<GLfloat> instancesRed, instancesBlue;
+  static constexpr GLuint INSTANCE_LOCATION = 5;
 
   using ShaderProgram = decltype(program);
 
   PlayerObject(const std::string &dir):
     dir(dir),
-    uTransform("transform"),
-    playerModelRed(Sprite<Model, RedPlayer>::create(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("ninja.3ds"s))),
-    playerModelBlue(Sprite<Model, BluePlayer>::create(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("ninja.3ds"s))),
+    playerModel(asset::Registry<Model>::load(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("ninja.3ds"s))),
+    skinRed(asset::Registry<TextureFile>::load(sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("nskinrd.jpg"s))),
     program({
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("player.vert"s),
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("player.frag"s)
@@ -52,53 +61,56 @@ struct PlayerObject {
 
   void init() {
     program.compile_program();
-    if(!playerModelRed->initialized) {
-      sys::HACK::swap_files(
-        sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("nskinbl.jpg"s),
-        sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("nskinrd.jpg"s)
-      );
-    }
-    playerModelRed->init();
-    if(!playerModelBlue->initialized) {
-      sys::HACK::swap_files(
-        sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("nskinbl.jpg"s),
-        sys::Path(dir) / sys::Path("assets"s) / sys::Path("ninja"s) / sys::Path("nskinrd.jpg"s)
-      );
-    }
-    playerModelBlue->init();
-    uTransform.set_id(program.id());
+    playerModel.load_async();
+    skinRed.load_async();
+    variantRed.instance_location = variantBlue.instance_location = INSTANCE_LOCATION;
     shadow.init();
   }
 
-  void display(const Player &player, Camera &cam) {
-    transform.rotation = extra_rotate;
-    transform.Rotate(0, 0, 1, player.unit.facing / M_PI * 180.f);
-    transform.SetPosition(player.unit.pos.x, player.unit.pos.y, player.unit.pos.z);
-
-    shadow.transform.SetPosition(player.unit.pos.x, player.unit.pos.y, .001);
-    shadow.display(cam);
-
-    ShaderProgram::use(program);
-
-    if(cam.has_changed || transform.has_changed) {
-      matrix = cam.get_matrix() * transform.get_matrix();
-      uTransform.set_data(matrix);
+  static void add_instance(std::vector<GLfloat> &instances, const glm::mat4 &m) {
+    const GLfloat *p = glm::value_ptr(m);
+    instances.insert(instances.end(), p, p + 16);
+  }
 
-      transform.has_changed = false;
+  void submit(gl::RenderQueue &queue, const std::vector<Player> &players, Camera &cam) {
+    TRACE_SCOPE("PlayerObject: submit");
+    instancesRed.clear();
+    instancesBlue.clear();
+    for(const Player &player : players) {
+      transform.rotation = extra_rotate;
+      transform.Rotate(0, 0, 1, player.unit.facing / M_PI * 180.f);
+      transform.SetPosition(player.unit.pos.x, player.unit.pos.y, player.unit.pos.z);
+      add_instance(!player.team ? instancesRed : instancesBlue, transform.get_matrix());
+
+      shadow.transform.SetPosition(player.unit.pos.x, player.unit.pos.y, .001);
+      shadow.add_instance(shadow.transform.get_matrix());
     }
-
-    if(!player.team) {
-      playerModelRed->display(program);
-    } else {
-      playerModelBlue->display(program);
+    shadow.submit_instances(queue, cam);
+    // the players show up once the model and the skins are loaded
+    if(!playerModel.ready() || !skinRed.ready())return;
+    if(variantRed.textures.empty()) {
+      variantRed.textures = {{"texture_diffuse1"s, skinRed->id}};
     }
 
-    ShaderProgram::unuse();
+    // the players of both teams overlap, the opaque pass has the depth test
+    // on rather than relying on the order of the draws
+    const gl::RenderQueue::Packet p(gl::RenderQueue::Pass::OPAQUE);
+    if(!instancesRed.empty()) {
+      variantRed.instance_offset = gl::StreamBuffer::write(instancesRed, sizeof(glm::mat4));
+      variantRed.instance_buffer = gl::StreamBuffer::id();
+      playerModel->submit(queue, p, program, instancesRed.size() / 16, &variantRed);
+    }
+    if(!instancesBlue.empty()) {
+      variantBlue.instance_offset = gl::StreamBuffer::write(instancesBlue, sizeof(glm::mat4));
+      variantBlue.instance_buffer = gl::StreamBuffer::id();
+      playerModel->submit(queue, p, program, instancesBlue.size() / 16, &variantBlue);
+    }
   }
 
   void clear() {
-    playerModelRed->clear();
-    playerModelBlue->clear();
+    playerModel.clear();
+    skinRed.clear();
+    shadow.clear();
     ShaderProgram::clear(program);
   }
 };
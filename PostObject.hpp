@@ -3,15 +3,15 @@
 #include "Transformation.hpp"
 #include "Camera.hpp"
 #include "Model.hpp"
+#include "RenderQueue.hpp"
+#include "Trace.hpp"
 
 struct PostObject {
   glm::mat4 matrix;
   glm::mat4 extra_rotate;
   Transformation transform;
 
-  class PostModel;
-  Sprite<Model, PostModel> *postModelSprite;
-  Model &postModel;
+  asset::Handle<Model> postModel;
   gl::Uniform<gl::UniformType::MAT4> uTransform;
   gl::ShaderProgram<
     gl::VertexShader,
@@ -24,8 +24,7 @@ struct PostObject {
   PostObject(bool team, const std::string &dir):
     team(team),
     uTransform("transform"),
-    postModelSprite(Sprite<Model, PostModel>::create(sys::Path(dir) / sys::Path("assets"s) / sys::Path("woodswing/woodswing.obj"s))),
-    postModel(postModelSprite->object),
+    postModel(asset::Registry<Model>::load(sys::Path(dir) / sys::Path("assets"s) / sys::Path("woodswing/woodswing.obj"s))),
     program({
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("post.vert"s),
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("post.frag"s)
@@ -41,27 +40,28 @@ struct PostObject {
 
   void init() {
     ShaderProgram::compile_program(program);
-    postModelSprite->init();
+    postModel.load_async();
     uTransform.set_id(program.id());
   }
 
-  void display(Camera &cam) {
-    ShaderProgram::use(program);
-
-    if(cam.has_changed || transform.has_changed) {
-      matrix = cam.get_matrix() * transform.get_matrix();
-      uTransform.set_data(matrix);
-
+  void submit(gl::RenderQueue &queue, Camera &cam) {
+    TRACE_SCOPE("PostObject: submit");
+    if(!postModel.ready())return;
+    if(transform.has_changed) {
+      matrix = transform.get_matrix();
       transform.has_changed = false;
     }
 
-    postModel.display(program);
-
-    ShaderProgram::unuse();
+    // the camera comes from the frame uniforms
+    gl::RenderQueue::Packet p(gl::RenderQueue::Pass::OPAQUE);
+    p.depth = queue.distance(glm::vec3(matrix[3]));
+    p.transform_location = uTransform.id();
+    p.transform = matrix;
+    postModel->submit(queue, p, program);
   }
 
   void clear() {
-    postModelSprite->clear();
+    postModel.clear();
     program.clear();
   }
 };
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ShaderProgram.hpp"
+#include "Shader.hpp"
+#include "Assets.hpp"
+#include "Text.hpp"
+#include "LabelCache.hpp"
+#include "StrConst.hpp"
+#include "File.hpp"
+#include "Timer.hpp"
+#include "FrameProfiler.hpp"
+#include "GLState.hpp"
+#include "StreamBuffer.hpp"
+
+// frame time overlay, toggled with F3
+struct ProfilerObject {
+  C_STRING(font_name, "assets/Verdana.ttf");
+  static constexpr Timer::time_t REFRESH_INTERVAL = .25;
+
+  asset::Handle<ui::Font> font;
+  ui::Text text;
+  gl::ShaderProgram<
+    gl::VertexShader,
+    gl::FragmentShader
+  > program;
+  std::vector<std::string> lines;
+  ui::LabelCache<size_t, std::string> line_labels;
+  bool visible = false;
+
+  Timer timer;
+  static constexpr Timer::key_t EVENT_REFRESH = 1;
+
+  // gl state counters at the last refresh
+  uint64_t last_frame = 0;
+  uint64_t last_gl_calls = 0, last_gl_elided = 0;
+  uint64_t last_stream_bytes = 0;
+
+  using ShaderProgram = decltype(program);
+
+  ProfilerObject(const std::string &dir):
+    font(asset::Registry<ui::Font>::load(sys::Path(dir) / sys::Path(font_name::c_str))),
+    text(*font),
+    program({
+      sys::Path(dir) / sys::Path("shaders"s) / sys::Path("btn_text.vert"s),
+      sys::Path(dir) / sys::Path("shaders"s) / sys::Path("btn_text.frag"s),
+    }),
+    line_labels(*font)
+  {
+    timer.set_timeout(EVENT_REFRESH, REFRESH_INTERVAL);
+  }
+
+  void init() {
+    font.init();
+    text.init(program);
+    text.color = glm::vec3(1, 1, .5);
+  }
+
+  void toggle() {
+    visible = !visible;
+  }
+
+  static std::string format_stats(const char *name, const FrameProfiler::Stats &stats) {
+    char line[128];
+    snprintf(line, sizeof(line), "%-12s avg %6.2f  p50 %6.2f  p99 %6.2f  max %6.2f",
+      name, stats.mean, stats.p50, stats.p99, stats.max);
+    return line;
+  }
+
+  void refresh(const FrameProfiler &profiler) {
+    lines.clear();
+    const FrameProfiler::Stats frame = profiler.frame_stats();
+    char line[128];
+    snprintf(line, sizeof(line), "%.0f fps, %lu frames, ms:", frame.mean > 0 ? 1e3 / frame.mean : 0., frame.count);
+    lines.push_back(line);
+    lines.push_back(format_stats("frame", frame));
+    if(profiler.frame > last_frame) {
+      const uint64_t no_frames = profiler.frame - last_frame;
+      snprintf(line, sizeof(line), "gl state: %lu calls, %lu elided per frame",
+        (gl::State::no_calls - last_gl_calls) / no_frames,
+        (gl::State::no_elided - last_gl_elided) / no_frames);
+      lines.push_back(line);
+      snprintf(line, sizeof(line), "stream: %lu bytes per frame, %lu orphaned",
+        (gl::StreamBuffer::no_bytes - last_stream_bytes) / no_frames,
+        gl::StreamBuffer::no_orphaned);
+      lines.push_back(line);
+    }
+    last_frame = profiler.frame;
+    last_gl_calls = gl::State::no_calls;
+    last_gl_elided = gl::State::no_elided;
+    last_stream_bytes = gl::StreamBuffer::no_bytes;
+    for(int i = 0; i < FrameProfiler::NO_PHASES; ++i) {
+      const FrameProfiler::Phase phase = FrameProfiler::Phase(i);
+      const FrameProfiler::Stats cpu = profiler.cpu_stats(phase);
+      if(cpu.count == 0)continue;
+      lines.push_back(format_stats(FrameProfiler::phase_names[i], cpu));
+      if(FrameProfiler::is_draw_pass(phase)) {
+        const FrameProfiler::Stats gpu = profiler.gpu_stats(phase);
+        if(gpu.count > 0) {
+          lines.push_back(format_stats("  gpu", gpu));
+        }
+      }
+    }
+  }
+
+  void display(const FrameProfiler &profiler) {
+    if(!visible)return;
+    timer.set_time(Timer::frame_time());
+    timer.periodic(EVENT_REFRESH, [&]() mutable {
+      refresh(profiler);
+    });
+    for(size_t i = 0; i < lines.size(); ++i) {
+      ui::Text &label = line_labels.get(i, lines[i], [&]() {
+        return lines[i];
+      });
+      label.color = text.color;
+      label.pos = glm::vec2(-.98, -.95 + .04 * i);
+      label.display(program, ui::Text::Positioning::LEFT, .6);
+    }
+    line_labels.prune();
+  }
+
+  void clear() {
+    line_labels.clear();
+    text.clear();
+    ShaderProgram::clear(program);
+    font.clear();
+  }
+};
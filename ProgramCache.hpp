@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <incgraphics.h>
+#include <Debug.hpp>
+#include <Logger.hpp>
+#include <File.hpp>
+
+namespace gl {
+// linked programs, named by a hash of their shader sources. programs with the
+// same sources are linked once per process and shared. with a directory set,
+// the binaries of linked programs are kept there and loaded with
+// glProgramBinary on the next start instead of compiling. the file name also
+// hashes the driver strings, and a binary the driver refuses is relinked from
+// the sources and written again
+struct ProgramCache {
+  static constexpr char MAGIC[8] = {'M', 'F', 'P', 'R', 'O', 'G', '\0', '\0'};
+  static constexpr uint64_t HASH_INIT = 14695981039346656037ULL;
+
+  struct Header {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+  };
+
+  struct Program {
+    GLuint id;
+    int no_users;
+  };
+
+  static inline std::unordered_map<uint64_t, Program> programs;
+  static inline std::string directory = "";
+  static inline int binaries = -1;
+  static inline uint64_t driver = 0;
+
+  static inline uint64_t no_shared = 0;
+  static inline uint64_t no_loaded = 0;
+  static inline uint64_t no_linked = 0;
+
+  // fnv-1a
+  static uint64_t hash(const void *data, size_t length, uint64_t h=HASH_INIT) {
+    const uint8_t *b = (const uint8_t *)data;
+    for(size_t i = 0; i < length; ++i) {
+      h = (h ^ b[i]) * 1099511628211ULL;
+    }
+    return h;
+  }
+
+  static uint64_t hash(const std::string &s, uint64_t h=HASH_INIT) {
+    // with the terminating zero, so that "ab" "c" differs from "a" "bc"
+    return hash(s.c_str(), s.length() + 1, h);
+  }
+
+  static void set_directory(const std::string &dir) {
+    directory = dir;
+    sys::make_directory(directory);
+  }
+
+  // GL 4.1 or ARB_get_program_binary, and at least one binary format
+  static bool has_binaries() {
+    if(binaries == -1) {
+      GLint no_formats = 0;
+      if(epoxy_gl_version() >= 41 || epoxy_has_gl_extension("GL_ARB_get_program_binary")) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &no_formats); GLERROR
+      }
+      binaries = (no_formats > 0);
+      driver = hash(std::string((const char *)glGetString(GL_VENDOR)));
+      driver = hash(std::string((const char *)glGetString(GL_RENDERER)), driver);
+      driver = hash(std::string((const char *)glGetString(GL_VERSION)), driver);
+      LOG(INFO, GRAPHICS, "program cache: %d binary formats\n", no_formats);
+    }
+    return binaries;
+  }
+
+  // binaries are kept
+  static bool enabled() {
+    return !directory.empty() && has_binaries();
+  }
+
+  // the sources and the driver
+  static uint64_t binary_key(uint64_t key) {
+    return hash(&driver, sizeof(driver), key);
+  }
+
+  static std::string filename(uint64_t key) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)binary_key(key));
+    return sys::Path(directory) / sys::Path(name);
+  }
+
+  // the program linked from these sources, with one more user. 0 if there
+  // is none yet
+  static GLuint find(uint64_t key) {
+    auto it = programs.find(key);
+    if(it == programs.end())return 0;
+    ++it->second.no_users;
+    ++no_shared;
+    return it->second.id;
+  }
+
+  static void add(uint64_t key, GLuint id) {
+    programs[key] = {id, 1};
+  }
+
+  // true for the last user, who deletes the program
+  static bool release(GLuint id) {
+    for(auto it = programs.begin(); it != programs.end(); ++it) {
+      if(it->second.id != id)continue;
+      if(--it->second.no_users > 0)return false;
+      programs.erase(it);
+      return true;
+    }
+    return true;
+  }
+
+  // links id from the binary on disk, false if there is none or the driver
+  // doesn't take it
+  static bool load_binary(uint64_t key, GLuint id) {
+    if(!enabled())return false;
+    const std::string fname = filename(key);
+    FILE *file = fopen(fname.c_str(), "rb");
+    if(file == nullptr)return false;
+    Header header;
+    std::vector<uint8_t> data;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+      && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+      && header.key == binary_key(key);
+    if(ok) {
+      data.resize(header.length);
+      ok = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+    if(!ok) {
+      LOG(WARNING, GRAPHICS, "program cache: '%s' doesn't match, relinking\n", fname.c_str());
+      return false;
+    }
+    glProgramBinary(id, header.format, data.data(), data.size());
+    // a format the driver no longer takes is an error, not a failure here
+    glGetError();
+    GLint status = GL_FALSE;
+    glGetProgramiv(id, GL_LINK_STATUS, &status); GLERROR
+    if(status != GL_TRUE) {
+      LOG(WARNING, GRAPHICS, "program cache: driver refused '%s', relinking\n", fname.c_str());
+      return false;
+    }
+    ++no_loaded;
+    return true;
+  }
+
+  // before linking, for a binary to save after
+  static void hint_retrievable(GLuint id) {
+    if(!enabled())return;
+    glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); GLERROR
+  }
+
+  static void save_binary(uint64_t key, GLenum format, const void *data, size_t length) {
+    if(!enabled() || length == 0)return;
+    const std::string fname = filename(key), tmpname = fname + ".tmp"s;
+    FILE *file = fopen(tmpname.c_str(), "wb");
+    if(file == nullptr) {
+      LOG(WARNING, GRAPHICS, "program cache: unable to write '%s'\n", tmpname.c_str());
+      return;
+    }
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.key = binary_key(key);
+    header.format = format;
+    header.length = length;
+    const bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+      && fwrite(data, 1, length, file) == length;
+    fclose(file);
+    // in place at once, a concurrent start never reads half a file
+    if(!ok || rename(tmpname.c_str(), fname.c_str()) != 0) {
+      LOG(WARNING, GRAPHICS, "program cache: unable to write '%s'\n", fname.c_str());
+      remove(tmpname.c_str());
+    }
+  }
+};
+} // namespace gl
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+#include "incgraphics.h"
+#include "Debug.hpp"
+#include "Logger.hpp"
+#include "GLState.hpp"
+
+namespace gl {
+// frames read back without waiting for them: glReadPixels into a pixel pack
+// buffer returns at once, and the pixels are only mapped when the buffer
+// comes around again N frames later, when the GPU is long done with it
+template <size_t N = 3>
+struct Readback {
+  GLuint pbos[N] = {0};
+  GLsync fences[N] = {nullptr};
+  uint64_t tags[N];
+  size_t current = 0;
+  size_t w=0, h=0;
+
+  Readback()
+  {}
+
+  size_t size() const {
+    return w * h * 4;
+  }
+
+  void init(size_t width, size_t height) {
+    w = width, h = height;
+    glGenBuffers(N, pbos); GLERROR
+    for(size_t i = 0; i < N; ++i) {
+      gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, size(), nullptr, GL_STREAM_READ); GLERROR
+    }
+    gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  // maps the pixels of request i, RGBA rows from the bottom
+  template <typename F>
+  void collect(size_t i, F &&func) {
+    if(fences[i] == nullptr)return;
+    glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX); GLERROR
+    glDeleteSync(fences[i]); GLERROR
+    fences[i] = nullptr;
+    gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+    const GLubyte *pixels = (const GLubyte *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size(), GL_MAP_READ_BIT); GLERROR
+    ASSERT(pixels != nullptr);
+    func(tags[i], pixels);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER); GLERROR
+    gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+
+  // reads the bound framebuffer. func gets the pixels of the request made N
+  // frames ago, if there is one
+  template <typename F>
+  void read(uint64_t tag, F &&func) {
+    collect(current, func);
+    gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, pbos[current]);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); GLERROR
+    gl::State::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); GLERROR
+    tags[current] = tag;
+    current = (current + 1) % N;
+  }
+
+  // the requests still in flight, oldest first
+  template <typename F>
+  void flush(F &&func) {
+    for(size_t i = 0; i < N; ++i) {
+      collect((current + i) % N, func);
+    }
+  }
+
+  void clear() {
+    for(size_t i = 0; i < N; ++i) {
+      if(fences[i] != nullptr) {
+        glDeleteSync(fences[i]); GLERROR
+        fences[i] = nullptr;
+      }
+      gl::State::forget_buffer(pbos[i]);
+    }
+    glDeleteBuffers(N, pbos); GLERROR
+  }
+};
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <glm/glm.hpp>
+
+#include "HeadlessContext.hpp"
+#include "Framebuffer.hpp"
+#include "RenderBuffer.hpp"
+#include "Readback.hpp"
+#include "StreamBuffer.hpp"
+#include "Assets.hpp"
+#include "GameObject.hpp"
+#include "CursorObject.hpp"
+#include "ProfilerObject.hpp"
+#include "FrameProfiler.hpp"
+#include "Button.hpp"
+#include "LabelCache.hpp"
+#include "StrConst.hpp"
+#include "Logger.hpp"
+
+// keyframes of the camera, linearly interpolated and held after the last one.
+// a file has one keyframe per line:
+//
+//   # time target_x target_y angle fov
+//   0    0   0  60 75
+//   2.5 -1.2 0  50 75
+struct CameraPath {
+  struct Key {
+    float time;
+    glm::vec3 target;
+    float angle;
+    float fov;
+  };
+
+  std::vector<Key> keys;
+
+  CameraPath()
+  {}
+
+  static CameraPath default_path() {
+    CameraPath path;
+    path.keys = {
+      { 0.f, glm::vec3(0, 0, 0), 60.f, 75.f},
+      { 2.f, glm::vec3(-1.2, 0, 0), 50.f, 75.f},
+      { 4.f, glm::vec3(1.2, -.5, 0), 70.f, 60.f},
+      { 6.f, glm::vec3(0, 0, 0), 60.f, 75.f},
+    };
+    return path;
+  }
+
+  bool load(const std::string &filename) {
+    FILE *fp = fopen(filename.c_str(), "r");
+    if(fp == nullptr) {
+      LOG(ERROR, GRAPHICS, "camera path: unable to open '%s'\n", filename.c_str());
+      return false;
+    }
+    keys.clear();
+    char line[256];
+    while(fgets(line, sizeof(line), fp) != nullptr) {
+      if(line[0] == '#')continue;
+      Key key;
+      if(sscanf(line, "%f %f %f %f %f", &key.time, &key.target.x, &key.target.y, &key.angle, &key.fov) != 5)continue;
+      key.target.z = 0;
+      keys.push_back(key);
+    }
+    fclose(fp);
+    LOG(INFO, GRAPHICS, "camera path: %lu keyframes from '%s'\n", keys.size(), filename.c_str());
+    return !keys.empty();
+  }
+
+  void apply(Camera &cam, float time, float ratio) const {
+    ASSERT(!keys.empty());
+    size_t i = 0;
+    while(i + 1 < keys.size() && keys[i + 1].time <= time) {
+      ++i;
+    }
+    const Key &a = keys[i];
+    const Key &b = (i + 1 < keys.size()) ? keys[i + 1] : a;
+    const float t = (b.time > a.time) ? std::fmin((time - a.time) / (b.time - a.time), 1.f) : 0.f;
+    cam.cameraTarget = a.target + (b.target - a.target) * t;
+    cam.angle = a.angle + (b.angle - a.angle) * t;
+    cam.fov = a.fov + (b.fov - a.fov) * t;
+    cam.update(ratio);
+    cam.has_changed = true;
+  }
+};
+
+// moves every player to a new spot every so often, the same spots on every
+// run, so that there is something to draw besides a still picture
+struct BenchIntelligence : public Intelligence<IntelligenceType::ABSTRACT> {
+  static constexpr Timer::time_t ORDER_INTERVAL = 1.;
+
+  Soccer &soccer;
+  Timer::time_t next_order = 0;
+  uint32_t seed = 1;
+
+  BenchIntelligence(Soccer &soccer):
+    soccer(soccer)
+  {}
+
+  float random() {
+    seed = seed * 1103515245 + 12345;
+    return float((seed >> 8) & 0xffff) / 0xffff;
+  }
+
+  void z_action() {}
+  void x_action(float) {}
+  void c_action(glm::vec3) {}
+  void v_action() {}
+  void f_action(float) {}
+  void s_action() {}
+  void m_action(glm::vec3) {}
+  void start() {}
+  bool should_stop() { return true; }
+  void stop() {}
+
+  void idle(Timer::time_t curtime) {
+    if(curtime >= next_order) {
+      for(const Player &p : soccer.players) {
+        soccer.m_action(p.id(), glm::vec3(3.6 * random() - 1.8, 1.9 * random() - .95, 0));
+      }
+      next_order = curtime + ORDER_INTERVAL;
+    }
+    soccer.idle(curtime);
+  }
+};
+
+// the game list of the metaserver menu, with made up games
+struct MenuScene {
+  static constexpr int NO_GAMES = 16;
+
+  C_STRING(font_name, "assets/Verdana.ttf");
+  C_STRING(hosttex_name, "assets/button.png");
+  C_STRING(exittex_name, "assets/button.png");
+  C_STRING(texture_name, "assets/button.png");
+  ui::Button<hosttex_name, font_name> host_button;
+  ui::Button<exittex_name, font_name> exit_button;
+  ui::Button<texture_name, font_name> button;
+  ui::LabelCache<int, std::string> game_labels;
+
+  MenuScene(const std::string &dir):
+    host_button(dir),
+    exit_button(dir),
+    button(dir),
+    game_labels(*button.font)
+  {}
+
+  void init() {
+    button.init();
+    exit_button.setx(-1, -.7);
+    exit_button.sety(.9, 1);
+    exit_button.init();
+    exit_button.label.set_text("Exit");
+    host_button.setx(.7, 1);
+    host_button.sety(.9, 1);
+    host_button.init();
+    host_button.label.set_text("Host");
+  }
+
+  void display() {
+    host_button.display();
+    exit_button.display();
+    button.setx(-.9, .9);
+    button.sety(-1, -1+.1);
+    for(int i = 0; i < NO_GAMES; ++i) {
+      const std::string name = "game " + std::to_string(i);
+      ui::Text &label = game_labels.get(i, name, [&]() {
+        return "127.0.0.1:" + std::to_string(5680 + i) + " : " + name;
+      });
+      button.display(label);
+      button.region.ys += .1;
+    }
+    game_labels.prune();
+  }
+
+  void clear() {
+    game_labels.clear();
+    button.clear();
+    exit_button.clear();
+    host_button.clear();
+  }
+};
+
+// renders a fixed number of frames of the game or of the menu into a
+// framebuffer, without a window, and reports the frame times. frames are
+// read back asynchronously and every dump_interval-th of them may be written
+// out as a ppm image
+//
+//   minififa --bench [--scene game|menu] [--frames N] [--size WxH]
+//                    [--team-size N] [--path file] [--csv file]
+//                    [--dump dir] [--dump-interval N]
+struct RenderBench {
+  enum class Scene { GAME, MENU };
+
+  struct Options {
+    Scene scene = Scene::GAME;
+    size_t no_frames = 300;
+    size_t width = 1280, height = 720;
+    size_t team_size = 11;
+    std::string path_file = "";
+    std::string csv_file = "";
+    std::string dump_dir = "";
+    size_t dump_interval = 60;
+  };
+
+  static constexpr Timer::time_t FRAME_DURATION = 1. / 60;
+
+  std::string dir;
+  Options opts;
+  HeadlessContext context;
+  CameraPath path;
+
+  Soccer soccer;
+  BenchIntelligence intelligence;
+  ui::CursorObject cursor;
+  FrameProfiler profiler;
+  ProfilerObject profilerObj;
+  GameObject game;
+  MenuScene menu;
+
+  gl::Framebuffer fb;
+  gl::Renderbuffer<GL_DEPTH24_STENCIL8> depth;
+  gl::Readback<> readback;
+
+  RenderBench(const std::string &dir, const Options &opts):
+    dir(dir),
+    opts(opts),
+    soccer(opts.team_size, opts.team_size),
+    intelligence(soccer),
+    cursor(dir),
+    profilerObj(dir),
+    game(soccer, intelligence, cursor, profiler, dir),
+    menu(dir)
+  {}
+
+  // the arguments after --bench, false on a malformed one
+  static bool parse_args(int argc, char *argv[], Options &opts) {
+    for(int i = 0; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if(i + 1 >= argc) {
+        LOG(ERROR, GRAPHICS, "bench: missing value of '%s'\n", arg.c_str());
+        return false;
+      }
+      const char *value = argv[++i];
+      if(arg == "--scene") {
+        if(!strcmp(value, "game")) {
+          opts.scene = Scene::GAME;
+        } else if(!strcmp(value, "menu")) {
+          opts.scene = Scene::MENU;
+        } else {
+          LOG(ERROR, GRAPHICS, "bench: unknown scene '%s'\n", value);
+          return false;
+        }
+      } else if(arg == "--frames") {
+        opts.no_frames = atol(value);
+      } else if(arg == "--size") {
+        if(sscanf(value, "%lux%lu", &opts.width, &opts.height) != 2) {
+          LOG(ERROR, GRAPHICS, "bench: size '%s' is not WxH\n", value);
+          return false;
+        }
+      } else if(arg == "--team-size") {
+        opts.team_size = atol(value);
+      } else if(arg == "--path") {
+        opts.path_file = value;
+      } else if(arg == "--csv") {
+        opts.csv_file = value;
+      } else if(arg == "--dump") {
+        opts.dump_dir = value;
+      } else if(arg == "--dump-interval") {
+        opts.dump_interval = std::max(1l, atol(value));
+      } else {
+        LOG(ERROR, GRAPHICS, "bench: unknown option '%s'\n", arg.c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void init() {
+    context.init();
+    ui::Font::setup();
+
+    fb.w = opts.width;
+    fb.h = opts.height;
+    fb.init();
+    fb.attach_texture<GL_COLOR_ATTACHMENT0>();
+    depth.init(opts.width, opts.height);
+    fb.attach_renderbuffer<GL_DEPTH_STENCIL_ATTACHMENT>(depth);
+    fb.bind();
+    ASSERT(gl::Framebuffer::is_complete());
+    readback.init(opts.width, opts.height);
+
+    if(opts.path_file == "" || !path.load(opts.path_file)) {
+      path = CameraPath::default_path();
+    }
+
+    cursor.init();
+    cursor.mouse(.5, .5);
+    profiler.init();
+    profilerObj.init();
+    profilerObj.toggle();
+    if(opts.scene == Scene::GAME) {
+      game.init();
+      game.set_winsize(opts.width, opts.height);
+    } else {
+      menu.init();
+    }
+  }
+
+  // the framebuffer is upside down
+  void dump(uint64_t frame, const GLubyte *pixels) {
+    if(opts.dump_dir == "" || frame % opts.dump_interval != 0)return;
+    char filename[32];
+    snprintf(filename, sizeof(filename), "frame%05lu.ppm", frame);
+    const std::string path = sys::Path(opts.dump_dir) / sys::Path(filename);
+    FILE *fp = fopen(path.c_str(), "wb");
+    if(fp == nullptr) {
+      LOG(ERROR, GRAPHICS, "bench: unable to open '%s'\n", path.c_str());
+      return;
+    }
+    fprintf(fp, "P6\n%lu %lu\n255\n", opts.width, opts.height);
+    std::vector<GLubyte> row(opts.width * 3);
+    for(size_t y = opts.height; y-- > 0;) {
+      const GLubyte *src = pixels + y * opts.width * 4;
+      for(size_t x = 0; x < opts.width; ++x) {
+        row[x * 3 + 0] = src[x * 4 + 0];
+        row[x * 3 + 1] = src[x * 4 + 1];
+        row[x * 3 + 2] = src[x * 4 + 2];
+      }
+      fwrite(row.data(), 1, row.size(), fp);
+    }
+    fclose(fp);
+  }
+
+  void display_frame(uint64_t frame) {
+    fb.bind();
+    glViewport(0, 0, opts.width, opts.height); GLERROR
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); GLERROR
+    if(opts.scene == Scene::GAME) {
+      {
+        auto phase = profiler.scope(FrameProfiler::IDLE);
+        path.apply(game.cam, frame * FRAME_DURATION, float(opts.width) / opts.height);
+        game.idle();
+        game.current_time += FRAME_DURATION;
+      }
+      game.display();
+    } else {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_MENU);
+      menu.display();
+    }
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_CURSOR);
+      cursor.display();
+    }
+    {
+      auto pass = profiler.scope(FrameProfiler::DISPLAY_HUD);
+      profilerObj.display(profiler);
+    }
+    gl::StreamBuffer::end_frame();
+  }
+
+  // the overlay's lines on stdout, for the logs of the CI
+  void report(double init_seconds, double seconds) {
+    printf("bench: %s, %lu frames at %lux%lu in %.3f s, %.1f fps\n",
+      opts.scene == Scene::GAME ? "game" : "menu",
+      opts.no_frames, opts.width, opts.height, seconds, opts.no_frames / seconds);
+    printf("bench: %s\n", glGetString(GL_RENDERER));
+    printf("bench: init in %.3f s, programs: %lu linked, %lu from the binary cache, %lu shared\n",
+      init_seconds, gl::ProgramCache::no_linked, gl::ProgramCache::no_loaded, gl::ProgramCache::no_shared);
+    profilerObj.refresh(profiler);
+    for(const std::string &line : profilerObj.lines) {
+      printf("%s\n", line.c_str());
+    }
+    if(opts.csv_file != "") {
+      profiler.dump_csv(opts.csv_file);
+    }
+  }
+
+  void run() {
+    const auto init_start = std::chrono::steady_clock::now();
+    init();
+    const double init_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - init_start).count();
+    auto on_pixels = [&](uint64_t frame, const GLubyte *pixels) mutable -> void {
+      dump(frame, pixels);
+    };
+    const auto start = std::chrono::steady_clock::now();
+    for(uint64_t frame = 0; frame < opts.no_frames; ++frame) {
+      Timer::update_frame_time();
+      profiler.begin_frame();
+      display_frame(frame);
+      {
+        // instead of swapping buffers
+        auto phase = profiler.scope(FrameProfiler::SWAP);
+        readback.read(frame, on_pixels);
+      }
+      profiler.end_frame();
+    }
+    readback.flush(on_pixels);
+    glFinish(); GLERROR
+    const auto end = std::chrono::steady_clock::now();
+    report(init_seconds, std::chrono::duration<double>(end - start).count());
+    clear();
+  }
+
+  void clear() {
+    if(opts.scene == Scene::GAME) {
+      game.clear();
+    } else {
+      menu.clear();
+    }
+    profilerObj.clear();
+    profiler.clear();
+    cursor.clear();
+    readback.clear();
+    depth.clear();
+    fb.clear();
+    asset::clear();
+    gl::StreamBuffer::clear();
+    ui::Font::cleanup();
+    context.clear();
+  }
+};
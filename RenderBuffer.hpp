@@ -15,11 +15,12 @@ struct Renderbuffer {
 
   auto id() const { return rbo; }
 
-  static void init(GLuint &rbo) {
+  static void init(GLuint &rbo, size_t width, size_t height) {
     glGenRenderbuffers(1, &rbo); GLERROR
     gl::Renderbuffer<StorageT>::bind(rbo);
 
-    glRenderbufferStorage(GL_RENDERBUFFER, StorageT, GL_RENDERBUFFER, rbo); GLERROR
+    glRenderbufferStorage(GL_RENDERBUFFER, StorageT, width, height); GLERROR
+    gl::Renderbuffer<StorageT>::unbind();
   }
 
   static void init(gl::Renderbuffer<StorageT> &rb, size_t width, size_t height) {
@@ -48,6 +49,7 @@ struct Renderbuffer {
 
   static void clear(GLuint &rbo) {
     glDeleteRenderbuffers(1, &rbo); GLERROR
+    rbo = 0;
   }
 
   static void clear(gl::Renderbuffer<StorageT> &rbo) {
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <incgraphics.h>
+#include <Debug.hpp>
+#include <Logger.hpp>
+#include <GLState.hpp>
+#include <StreamBuffer.hpp>
+
+namespace gl {
+// the draws of a frame. objects submit packets instead of drawing, execute()
+// sorts them by a 64-bit key and draws them in that order, so that packets
+// with the same program and texture end up next to each other and the state
+// cache elides the binds between them. the key is
+//
+//   pass:8 | program:16 | texture:16 | depth:24     (opaque passes)
+//   pass:8 | depth:24 | program:16 | texture:16     (blended passes)
+//
+// opaque packets are drawn front to back within a program and texture,
+// blended ones back to front regardless of them
+struct RenderQueue {
+  enum class Pass : uint8_t {
+    BACKGROUND, // the passes are drawn in this order
+    GROUND,
+    DECALS, // blended onto the ground
+    OPAQUE,
+    TRANSPARENT,
+    NO_PASSES
+  };
+
+  static constexpr int MAX_TEXTURES = 4;
+  // depths are distances from the eye, quantized in [0, MAX_DEPTH)
+  static constexpr float MAX_DEPTH = 16.f;
+  static constexpr uint64_t DEPTH_MASK = (uint64_t(1) << 24) - 1;
+
+  struct Packet {
+    Pass pass;
+    GLuint program = 0;
+    GLuint textures[MAX_TEXTURES];
+    int no_textures = 0;
+    GLuint vertex_array = 0;
+    float depth = 0;
+    // uploaded before draw if set
+    GLint transform_location = -1;
+    glm::mat4 transform;
+    // per-packet uniforms and the draw call, with the program, the textures
+    // and the vertex array already bound
+    std::function<void()> draw;
+
+    Packet(Pass pass=Pass::OPAQUE):
+      pass(pass)
+    {}
+
+    void add_texture(GLuint id) {
+      ASSERT(no_textures < MAX_TEXTURES);
+      textures[no_textures++] = id;
+    }
+  };
+
+  struct Item {
+    uint64_t key;
+    uint32_t index;
+  };
+
+  std::vector<Packet> packets;
+  std::vector<Item> items, items_tmp;
+  size_t no_packets = 0;
+  glm::vec3 eye;
+
+  RenderQueue()
+  {}
+
+  static bool is_blended(Pass pass) {
+    return pass == Pass::DECALS || pass == Pass::TRANSPARENT;
+  }
+
+  void begin(const glm::vec3 &eye_position) {
+    eye = eye_position;
+    no_packets = 0;
+  }
+
+  // the storage of the packets is kept between frames
+  Packet &add(const Packet &base) {
+    if(no_packets == packets.size()) {
+      packets.emplace_back();
+    }
+    Packet &p = packets[no_packets++];
+    p = base;
+    return p;
+  }
+
+  Packet &add(Pass pass) {
+    return add(Packet(pass));
+  }
+
+  float distance(const glm::vec3 &pos) const {
+    return glm::distance(eye, pos);
+  }
+
+  static uint64_t quantize(float depth) {
+    if(depth <= 0)return 0;
+    if(depth >= MAX_DEPTH)return DEPTH_MASK;
+    return uint64_t(depth / MAX_DEPTH * float(DEPTH_MASK));
+  }
+
+  static uint64_t make_key(const Packet &p) {
+    const uint64_t pass = uint64_t(p.pass);
+    const uint64_t program = p.program & 0xffff;
+    const uint64_t texture = (p.no_textures > 0 ? p.textures[0] : 0) & 0xffff;
+    uint64_t depth = quantize(p.depth);
+    if(is_blended(p.pass)) {
+      depth = DEPTH_MASK - depth;
+      return pass << 56 | depth << 32 | program << 16 | texture;
+    }
+    return pass << 56 | program << 40 | texture << 24 | depth;
+  }
+
+  // least significant digit first, a byte at a time. a byte that is the
+  // same in every key is skipped, which is most of them for a small queue
+  void sort() {
+    items.resize(no_packets);
+    items_tmp.resize(no_packets);
+    for(uint32_t i = 0; i < no_packets; ++i) {
+      items[i] = (Item){ .key = make_key(packets[i]), .index = i };
+    }
+    for(int shift = 0; shift < 64; shift += 8) {
+      size_t counts[256] = {0};
+      for(const Item &item : items) {
+        ++counts[(item.key >> shift) & 0xff];
+      }
+      if(no_packets == 0 || counts[(items[0].key >> shift) & 0xff] == no_packets)continue;
+      size_t offset = 0;
+      for(int b = 0; b < 256; ++b) {
+        const size_t c = counts[b];
+        counts[b] = offset;
+        offset += c;
+      }
+      for(const Item &item : items) {
+        items_tmp[counts[(item.key >> shift) & 0xff]++] = item;
+      }
+      items.swap(items_tmp);
+    }
+  }
+
+  static void set_pass_state(Pass pass) {
+    switch(pass) {
+      case Pass::BACKGROUND:
+      case Pass::GROUND:
+        gl::State::disable(GL_DEPTH_TEST);
+        gl::State::disable(GL_BLEND);
+      break;
+      case Pass::DECALS:
+        gl::State::disable(GL_DEPTH_TEST);
+        gl::State::enable(GL_BLEND);
+        gl::State::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+      break;
+      case Pass::OPAQUE:
+        gl::State::enable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS); GLERROR
+        gl::State::disable(GL_BLEND);
+      break;
+      case Pass::TRANSPARENT:
+        // tested against the opaque geometry, but don't hide each other
+        gl::State::enable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE); GLERROR
+        gl::State::enable(GL_BLEND);
+        gl::State::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+      break;
+      case Pass::NO_PASSES:
+      break;
+    }
+  }
+
+  void execute() {
+    sort();
+    // the packets may draw what was written into the stream
+    gl::StreamBuffer::unmap();
+    Pass pass = Pass::NO_PASSES;
+    for(const Item &item : items) {
+      const Packet &p = packets[item.index];
+      if(p.pass != pass) {
+        pass = p.pass;
+        set_pass_state(pass);
+      }
+      gl::State::use_program(p.program);
+      for(int i = 0; i < p.no_textures; ++i) {
+        gl::State::set_active_texture(i);
+        gl::State::bind_texture(p.textures[i]);
+      }
+      gl::State::bind_vertex_array(p.vertex_array);
+      if(p.transform_location != -1) {
+        glUniformMatrix4fv(p.transform_location, 1, GL_FALSE, glm::value_ptr(p.transform)); GLERROR
+      }
+      p.draw();
+    }
+    // what the code drawing outside of the queue expects
+    if(pass == Pass::TRANSPARENT) {
+      glDepthMask(GL_TRUE); GLERROR
+    }
+    gl::State::disable(GL_DEPTH_TEST);
+    gl::State::disable(GL_BLEND);
+    no_packets = 0;
+  }
+
+  void clear() {
+    packets.clear();
+    items.clear();
+    items_tmp.clear();
+    no_packets = 0;
+  }
+};
+} // namespace gl
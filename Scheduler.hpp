@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <functional>
+
+#include "Timer.hpp"
+
+// one-shot events ordered by their absolute expiry in a min-heap. advance()
+// fires every event that has expired exactly once, so the cost of a tick is
+// in the number of events rather than in the number of checks. rescheduling
+// or cancelling a key bumps its generation, the stale heap entries are
+// skipped when they come up
+struct Scheduler {
+  using time_t = Timer::time_t;
+  using key_t = uint32_t;
+
+  struct Entry {
+    time_t expiry;
+    key_t key;
+    uint32_t generation;
+
+    // equal expiries fire by key, which keeps the order the same on every
+    // lockstep peer
+    bool operator>(const Entry &other) const {
+      if(expiry != other.expiry)return expiry > other.expiry;
+      return key > other.key;
+    }
+  };
+
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+  std::vector<uint32_t> generations;
+  std::vector<bool> pending;
+  time_t current_time = Timer::time_start();
+
+  Scheduler()
+  {}
+
+  void reserve(key_t key) {
+    if(key >= generations.size()) {
+      generations.resize(key + 1, 0);
+      pending.resize(key + 1, false);
+    }
+  }
+
+  // replaces the pending expiry of key, if there is one
+  void schedule(key_t key, time_t expiry) {
+    reserve(key);
+    ++generations[key];
+    pending[key] = true;
+    queue.push((Entry){
+      .expiry = expiry,
+      .key = key,
+      .generation = generations[key]
+    });
+  }
+
+  void schedule_in(key_t key, time_t delay) {
+    schedule(key, current_time + delay);
+  }
+
+  void cancel(key_t key) {
+    if(!is_pending(key))return;
+    ++generations[key];
+    pending[key] = false;
+  }
+
+  bool is_pending(key_t key) const {
+    return key < pending.size() && pending[key];
+  }
+
+  // an event fires on the first advance past its expiry
+  template <typename F>
+  void advance(time_t curtime, F &&fire) {
+    current_time = curtime;
+    while(!queue.empty() && queue.top().expiry < current_time) {
+      const Entry entry = queue.top();
+      queue.pop();
+      if(entry.generation != generations[entry.key])continue;
+      pending[entry.key] = false;
+      fire(entry.key);
+    }
+  }
+
+  void clear() {
+    queue = decltype(queue)();
+    generations.clear();
+    pending.clear();
+  }
+};
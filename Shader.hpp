@@ -5,6 +5,7 @@
 #include <File.hpp>
 #include <Debug.hpp>
 #include <Logger.hpp>
+#include <AssetPack.hpp>
 
 #include <string>
 #include <cstdlib>
@@ -56,11 +57,27 @@ struct Shader {
     return shaderId;
   }
 
+  static constexpr GLenum type() {
+    return gl::get_gl_shader_constant<ShaderT>();
+  }
+
+  std::string source() {
+    const AssetPack::Entry *e = AssetPack::find(file.name(), AssetPack::Type::SHADER);
+    if(e != nullptr) {
+      return std::string(AssetPack::at<char>(e), e->size);
+    }
+    return file.load_text();
+  }
+
   void init() {
-    shaderId = glCreateShader(gl::get_gl_shader_constant<ShaderT>()); GLERROR
-    std::string source_code = file.load_text();
+    init(source());
+  }
+
+  void init(const std::string &source_code) {
+    shaderId = glCreateShader(type()); GLERROR
     const char *source = source_code.c_str();
-    glShaderSource(shaderId, 1, &source, nullptr); GLERROR
+    const GLint length = source_code.length();
+    glShaderSource(shaderId, 1, &source, &length); GLERROR
     glCompileShader(shaderId); GLERROR
   }
 
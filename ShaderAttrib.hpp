@@ -87,7 +87,7 @@ struct Attrib <gl::Buffer<BufferT, ElementT>> {
   }
 
   static void unbind() {
-    glBindBuffer(BufferT, 0); GLERROR
+    gl::State::unbind_buffer(BufferT);
   }
 
   static void clear(self_t &attr) {
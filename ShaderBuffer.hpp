@@ -10,6 +10,7 @@
 
 #include <Debug.hpp>
 #include <Logger.hpp>
+#include <GLState.hpp>
 
 #include <Transformation.hpp>
 
@@ -101,7 +102,7 @@ struct Buffer {
   }
 
   static void bind(GLuint vbo) {
-    glBindBuffer(BufferT, vbo); GLERROR
+    gl::State::bind_buffer(BufferT, vbo);
   }
 
   static void bind(const self_t &buf) {
@@ -125,7 +126,7 @@ struct Buffer {
 
     this->bind();
     glBufferData(BufferT, this->sizeOfBuffer, &host_data[start], DRAW_MODE); GLERROR
-    Logger::Info("allocated buffer data: bytes=%lu, no_scalars=%lu, no_elems_per_element\n",
+    LOG(DEBUG, GRAPHICS, "allocated buffer data: bytes=%lu, no_scalars=%lu, no_elems_per_element=%lu\n",
                  sizeOfBuffer, numberOfScalars, numberOfScalarsPerElement);
     this->unbind();
 
@@ -153,7 +154,7 @@ struct Buffer {
 
     this->bind();
     glBufferData(BufferT, this->sizeOfBuffer, &host_data[start], DRAW_MODE); GLERROR
-    Logger::Info("allocated buffer data: bytes=%lu, no_scalars=%lu, no_elements=%lu, no_elems_per_element=%lu\n",
+    LOG(DEBUG, GRAPHICS, "allocated buffer data: bytes=%lu, no_scalars=%lu, no_elements=%lu, no_elems_per_element=%lu\n",
                  this->sizeOfBuffer, this->numberOfScalars, this->numberOfElements, this->numberOfScalarsPerElement);
     this->unbind();
 
@@ -165,22 +166,37 @@ struct Buffer {
     allocate<DRAW_MODE>(host_data, start, count);
   }
 
+  // replaces the contents with host_data, reallocating only when it doesn't
+  // fit. the buffer may be larger than the data afterwards
+  template <GLenum DRAW_MODE, typename T>
+  void update(const std::vector<T> &host_data) {
+    if(host_data.empty())return;
+    if(host_data.size() > this->numberOfScalars) {
+      allocate<DRAW_MODE>(host_data);
+    } else {
+      set_subdata(host_data);
+    }
+  }
+
   template <typename VecT>
   void show_transformation(Transformation &t, std::vector<float> &&points) {
     size_t no_prims = points.size() / numberOfScalarsPerElement;
     for(size_t i = 0; i < no_prims; ++i) {
       VecT v;
-      Logger::Info("element %d (", i);
+      char value[32];
+      std::string line = "element " + std::to_string(i) + " (";
       for(int j = 0; j < numberOfScalarsPerElement; ++j) {
         v[j] = points[i * numberOfScalarsPerElement + j];
-        Logger::Info("%.2f ", v[j]);
+        snprintf(value, sizeof(value), "%.2f ", v[j]);
+        line += value;
       }
-      Logger::Info(") --> ");
+      line += ") --> (";
       v = t * v;
       for(int j = 0; j < numberOfScalarsPerElement; ++j) {
-        Logger::Info("%.2f ", v[j]);
+        snprintf(value, sizeof(value), "%.2f ", v[j]);
+        line += value;
       }
-      Logger::Info(")\n");
+      LOG(INFO, GRAPHICS, "%s)\n", line.c_str());
     }
   }
 
@@ -209,17 +225,18 @@ struct Buffer {
 
     this->bind();
     glBufferSubData(BufferT, start * sizeof(T), sizeof(T) * count, &host_data[start]); GLERROR
-    Logger::Info("set buffer subdata: bytes=%lu, no_elems=%lu, no_elements=%lu, no_elems_per_element\n",
+    LOG(DEBUG, GRAPHICS, "set buffer subdata: bytes=%lu, no_elems=%lu, no_elements=%lu, no_elems_per_element=%lu\n",
                  sizeOfBuffer, numberOfScalars, numberOfElements, numberOfScalarsPerElement);
     this->unbind();
   }
 
   static void unbind() {
-    glBindBuffer(BufferT, 0); GLERROR
+    gl::State::unbind_buffer(BufferT);
   }
 
   static void clear(GLuint &vbo) {
     glDeleteBuffers(1, &vbo); GLERROR
+    gl::State::forget_buffer(vbo);
   }
 
   static void clear(self_t &buf) {
@@ -9,6 +9,10 @@
 #include <Tuple.hpp>
 #include <Shader.hpp>
 #include <ShaderAttrib.hpp>
+#include <ShaderUniform.hpp>
+#include <FrameUniforms.hpp>
+#include <GLState.hpp>
+#include <ProgramCache.hpp>
 #include <VertexArray.hpp>
 
 namespace gl {
@@ -75,11 +79,14 @@ public:
     Binary(ShaderProgram<ShaderTs...> &program) {
       size = program.get<GL_PROGRAM_BINARY_LENGTH>();
       data = malloc(size);
+      if(size == 0)return;
       GLint written_bytes;
       glGetProgramBinary(program.id(), size, &written_bytes, &format, data); GLERROR
       ASSERT(size == written_bytes);
     }
 
+    Binary(const Binary &) = delete;
+
     ~Binary() {
       free(data);
     }
@@ -89,26 +96,59 @@ public:
     program.compile_program();
   }
 
+  // shared with the programs of the same sources, or loaded from the binary
+  // cache, or compiled and linked
   void compile_program() {
+    std::vector<std::string> sources;
+    uint64_t key = gl::ProgramCache::HASH_INIT;
     Tuple::for_each(shaders, [&](auto &s) mutable -> void {
-      if(shaderOwnership) {
-        s.init();
-      }
+      const GLenum type = s.type();
+      sources.push_back(s.source());
+      key = gl::ProgramCache::hash(&type, sizeof(type), key);
+      key = gl::ProgramCache::hash(sources.back(), key);
     });
 
+    programId = gl::ProgramCache::find(key);
+    if(programId != 0) {
+      return;
+    }
     programId = glCreateProgram(); GLERROR
     ASSERT(this->programId != 0);
+    if(!gl::ProgramCache::load_binary(key, programId)) {
+      link_program(sources);
+      if(gl::ProgramCache::enabled()) {
+        Binary binary = get_binary();
+        gl::ProgramCache::save_binary(key, binary.format, binary.data, binary.size);
+      }
+    }
+    gl::ProgramCache::add(key, programId);
+    gl::UniformTable::reflect(programId);
+    gl::FrameUniforms::attach(programId);
+    ASSERT(this->is_valid());
+  }
+
+  void link_program(const std::vector<std::string> &sources) {
+    size_t i = 0;
+    Tuple::for_each(shaders, [&](auto &s) mutable -> void {
+      if(shaderOwnership) {
+        s.init(sources[i]);
+      }
+      ++i;
+    });
+
     Tuple::for_each(shaders, [&](auto &s) mutable -> void {
       glAttachShader(programId, s.id()); GLERROR
     });
+    gl::ProgramCache::hint_retrievable(programId);
     glLinkProgram(programId); GLERROR
+    ++gl::ProgramCache::no_linked;
 
     Tuple::for_each(shaders, [&](auto &s) mutable -> void {
+      glDetachShader(programId, s.id()); GLERROR
       if(shaderOwnership) {
         s.clear();
       }
     });
-    ASSERT(this->is_valid());
   }
 
   void bind_attrib(int index, const std::string &location) {
@@ -181,7 +221,7 @@ public:
 
 
   static void use(GLuint progId) {
-    glUseProgram(progId); GLERROR
+    gl::State::use_program(progId);
   }
 
   static void use(self_t &program) {
@@ -197,7 +237,7 @@ public:
   }
 
   static void unuse() {
-    glUseProgram(0); GLERROR
+    gl::State::unuse_program();
   }
 
   static void clear(self_t &program) {
@@ -205,16 +245,17 @@ public:
   }
 
   void clear() {
-    Tuple::for_each(shaders, [&](auto &s) {
-      glDetachShader(programId, s.id()); GLERROR
-    });
+    // the last of the programs sharing it deletes it
+    if(!gl::ProgramCache::release(programId))return;
     glDeleteProgram(programId); GLERROR
+    gl::State::forget_program(programId);
+    gl::UniformTable::forget(programId);
   }
 
   bool is_valid() {
     glValidateProgram(programId); GLERROR
     int params = get<GL_VALIDATE_STATUS>();
-    Logger::Info("programId %d GL_VALIDATE_STATUS = %d\n", programId, params);
+    LOG(DEBUG, GRAPHICS, "programId %d GL_VALIDATE_STATUS = %d\n", programId, params);
     print_info_log();
     print_all();
     return params == GL_TRUE;
@@ -245,21 +286,21 @@ public:
     int actual_length = 0;
     char programId_log[2048];
     glGetProgramInfoLog(programId, max_length, &actual_length, programId_log); GLERROR
-    Logger::Info("programId info log for GL index %u:\n%s\n", programId, programId_log);
+    LOG(DEBUG, GRAPHICS, "programId info log for GL index %u:\n%s\n", programId, programId_log);
   }
 
   void print_all() {
-    Logger::Info("--------------------\n");
-    Logger::Info("shader programId %d info:\n", programId);
+    LOG(DEBUG, GRAPHICS, "--------------------\n");
+    LOG(DEBUG, GRAPHICS, "shader programId %d info:\n", programId);
     int params = -1;
     params = get<GL_LINK_STATUS>();
-    Logger::Info("GL_LINK_STATUS = %d\n", params);
+    LOG(DEBUG, GRAPHICS, "GL_LINK_STATUS = %d\n", params);
 
     params = get<GL_ATTACHED_SHADERS>();
-    Logger::Info("GL_ATTACHED_SHADERS = %d\n", params);
+    LOG(DEBUG, GRAPHICS, "GL_ATTACHED_SHADERS = %d\n", params);
 
     params = get<GL_ACTIVE_ATTRIBUTES>();
-    Logger::Info("GL_ACTIVE_ATTRIBUTES = %d\n", params);
+    LOG(DEBUG, GRAPHICS, "GL_ACTIVE_ATTRIBUTES = %d\n", params);
     for (int i = 0; i < params; i++) {
       char name[64];
       int max_length = 64;
@@ -272,16 +313,16 @@ public:
           char long_name[64];
           sprintf(long_name, "%s[%d]", name, j);
           int location = glGetAttribLocation(programId, long_name); GLERROR
-          Logger::Info("  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), long_name, location);
+          LOG(DEBUG, GRAPHICS, "  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), long_name, location);
         }
       } else {
         int location = glGetAttribLocation(programId, name); GLERROR
-        Logger::Info("  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), name, location);
+        LOG(DEBUG, GRAPHICS, "  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), name, location);
       }
     }
 
     params = get<GL_ACTIVE_UNIFORMS>();
-    Logger::Info("GL_ACTIVE_UNIFORMS = %d\n", params);
+    LOG(DEBUG, GRAPHICS, "GL_ACTIVE_UNIFORMS = %d\n", params);
     for(int i = 0; i < params; i++) {
       char name[256];
       int max_length = 64;
@@ -294,11 +335,11 @@ public:
           char long_name[256];
           sprintf(long_name, "%s[%d]", name, j);
           int location = glGetUniformLocation(programId, long_name); GLERROR
-          Logger::Info("  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), long_name, location);
+          LOG(DEBUG, GRAPHICS, "  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), long_name, location);
         }
       } else {
         int location = glGetUniformLocation(programId, name); GLERROR
-        Logger::Info("  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), name, location);
+        LOG(DEBUG, GRAPHICS, "  %d) type:%s name:%s location:%d\n", i, GL_type_to_string(type), name, location);
       }
     }
   }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <type_traits>
 
@@ -31,6 +32,54 @@ template <> struct u_cast_type <UniformType::MAT4> {      using type = glm::mat4
 template <> struct u_cast_type <UniformType::SAMPLER2D> { using type = GLuint;     using vtype = int;   using_sc gltype = GL_SAMPLER_2D; };
 #undef using_sc
 
+// locations of the active uniforms of every linked program, reflected once
+// after linking. binding a uniform to a program is then a lookup instead of a
+// glGetUniformLocation
+struct UniformTable {
+  static inline std::map<GLuint, std::map<std::string, GLint>> programs;
+
+  static void reflect(GLuint program_id) {
+    auto &locations = programs[program_id];
+    locations.clear();
+    GLint no_uniforms = 0;
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &no_uniforms); GLERROR
+    for(GLint i = 0; i < no_uniforms; ++i) {
+      char name[256];
+      GLsizei length;
+      GLint size;
+      GLenum t;
+      glGetActiveUniform(program_id, i, sizeof(name), &length, &size, &t, name); GLERROR
+      const GLint lc = glGetUniformLocation(program_id, name); GLERROR
+      // uniforms in blocks have no location
+      if(lc < 0)continue;
+      std::string uname(name, length);
+      // arrays are reported as name[0]
+      if(uname.size() > 3 && uname.compare(uname.size() - 3, 3, "[0]") == 0) {
+        uname.resize(uname.size() - 3);
+      }
+      locations[uname] = lc;
+    }
+    LOG(DEBUG, GRAPHICS, "program %u: %lu active uniforms\n", program_id, locations.size());
+  }
+
+  static GLint find(GLuint program_id, const std::string &name) {
+    auto p = programs.find(program_id);
+    if(p == std::end(programs)) {
+      GLint lc = glGetUniformLocation(program_id, name.c_str()); GLERROR
+      return lc;
+    }
+    auto u = p->second.find(name);
+    if(u == std::end(p->second)) {
+      return -1;
+    }
+    return u->second;
+  }
+
+  static void forget(GLuint program_id) {
+    programs.erase(program_id);
+  }
+};
+
 template <UniformType U>
 struct Uniform {
   using type = typename u_cast_type<U>::type;
@@ -59,8 +108,7 @@ struct Uniform {
     if(location == "") {
       TERMINATE("location is unset\n");
     }
-    GLuint lc = glGetUniformLocation(progId, location.c_str()); GLERROR
-    return lc;
+    return UniformTable::find(progId, location);
   }
   void set_id(GLuint program_id) {
     if(program_id == 0) {
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
 #include "Transformation.hpp"
 #include "Camera.hpp"
 #include "Shader.hpp"
@@ -8,18 +11,21 @@
 #include "ShaderAttrib.hpp"
 #include "VertexArray.hpp"
 #include "ShaderProgram.hpp"
+#include "RenderQueue.hpp"
+#include "StreamBuffer.hpp"
 
 struct Shadow {
-  glm::mat4 matrix;
   Transformation transform;
   gl::ShaderProgram<
     gl::VertexShader,
     gl::FragmentShader
   > program;
-  gl::Uniform<gl::UniformType::MAT4> uTransform;
   gl::Buffer<GL_ARRAY_BUFFER, gl::BufferElementType::VEC2> buf;
   gl::Attrib<decltype(buf)> attrVertex;
   gl::VertexArray<decltype(attrVertex)> vao;
+  // model matrices of the shadows drawn at once, streamed
+  std::vector<GLfloat> instances;
+  static constexpr GLuint INSTANCE_LOCATION = 1;
 
   using ShaderBuffer = decltype(buf);
   using ShaderAttrib = decltype(attrVertex);
@@ -32,7 +38,6 @@ struct Shadow {
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("shadow.vert"s),
       sys::Path(dir) / sys::Path("shaders"s) / sys::Path("shadow.frag"s)
     }),
-    uTransform("transform"),
     attrVertex("vertex"s, buf),
     vao(attrVertex)
   {
@@ -49,29 +54,37 @@ struct Shadow {
     vao.enable(attrVertex);
     vao.set_access(attrVertex, 0);
 
+
     ShaderProgram::init(program, vao);
-    uTransform.set_id(program.id());
   }
 
-  void display(Camera &cam) {
-    ShaderProgram::use(program);
-
-    glEnable(GL_BLEND); GLERROR
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); GLERROR
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO); GLERROR
-
-    if(cam.has_changed || transform.has_changed) {
-      matrix = cam.get_matrix() * transform.get_matrix();
-      uTransform.set_data(matrix);
-
-      transform.has_changed = false;
-    }
+  void submit(gl::RenderQueue &queue, Camera &cam) {
+    instances.clear();
+    add_instance(transform.get_matrix());
+    submit_instances(queue, cam);
+  }
 
-    VertexArray::draw<GL_TRIANGLES>(vao);
+  void add_instance(const glm::mat4 &m) {
+    const GLfloat *p = glm::value_ptr(m);
+    instances.insert(instances.end(), p, p + 16);
+  }
 
-    glDisable(GL_BLEND); GLERROR
+  // all shadows added since the last call, in one draw. they lie on the
+  // ground, the depth of the first one stands for all of them
+  void submit_instances(gl::RenderQueue &queue, Camera &cam) {
+    const size_t no_instances = instances.size() / 16;
+    if(no_instances == 0)return;
+    const size_t offset = gl::StreamBuffer::write(instances, sizeof(glm::mat4));
+    vao.set_instanced_mat4(INSTANCE_LOCATION, gl::StreamBuffer::id(), offset);
 
-    ShaderProgram::unuse();
+    gl::RenderQueue::Packet &p = queue.add(gl::RenderQueue::Pass::DECALS);
+    p.program = program.id();
+    p.vertex_array = vao.id();
+    p.depth = queue.distance(glm::vec3(instances[12], instances[13], instances[14]));
+    p.draw = [this, no_instances]() mutable -> void {
+      vao.draw_instanced<GL_TRIANGLES>(0, buf.numberOfElements, no_instances);
+    };
+    instances.clear();
   }
 
   void clear() {
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <mutex>
 
 #include "Ball.hpp"
 #include "Player.hpp"
 #include "Timer.hpp"
+#include "Scheduler.hpp"
+#include "Deterministic.hpp"
+#include "Trace.hpp"
 
 struct Team;
 
@@ -34,13 +38,27 @@ struct Soccer {
     set_timer();
   }
 
+  // cooldowns of the ball and of the players. keys of the ball come first,
+  // then those of every player in the order of their ids
+  Scheduler scheduler;
+
   void set_timer() {
-    ball.set_timer();
+    scheduler.clear();
+    ball.set_timer(scheduler, 0);
     for(auto &p : players) {
-      p.set_timer();
+      p.set_timer(scheduler, Ball::NO_EVENTS + p.id() * Player::NO_EVENTS);
     }
   }
 
+  void fire_event(Scheduler::key_t key) {
+    if(key < Ball::NO_EVENTS) {
+      ball.on_event(Ball::Event(key));
+      return;
+    }
+    key -= Ball::NO_EVENTS;
+    players[key / Player::NO_EVENTS].on_event(Player::Event(key % Player::NO_EVENTS));
+  }
+
 // gameplay
   Timer timer;
   enum class GameState {
@@ -115,14 +133,23 @@ struct Soccer {
 
   Team team1, team2;
 
+  // every tick folds the state into it, so two runs with equal hashes went
+  // through the same states
+  uint64_t rolling_hash = det::Hash().value;
+
   void idle(Timer::time_t curtime) {
+    TRACE_SCOPE("soccer: idle");
     std::lock_guard<std::recursive_mutex> guard(mtx);
     timer.set_time(curtime);
+    scheduler.advance(timer.current_time, [&](Scheduler::key_t key) mutable {
+      fire_event(key);
+    });
     idle_control();
     ball.idle(timer.current_time);
     for(auto &p: players) {
       p.idle(timer.current_time);
     }
+    rolling_hash = det::Hash(rolling_hash).feed(checksum()).value;
   }
 
   void idle_control() {
@@ -148,6 +175,8 @@ struct Soccer {
   int find_best_possession(Ball &ball) {
     // if noone controls, closest gets the ball
     // if someone controls, closest other than the owner or nothing controls the ball
+    // players are visited by id and a tie keeps the lower id, so that every
+    // lockstep peer picks the same owner
     Unit::loc_t ball_pos = ball.position();
     int owner = ball.owner();
     double bcp = NAN; // best control potential
@@ -218,6 +247,23 @@ struct Soccer {
     }
   }
 
+  // hash of the state that evolves during the game
+  uint64_t checksum() {
+    std::lock_guard<std::recursive_mutex> guard(mtx);
+    det::Hash hash;
+    auto feed_unit = [&](const Unit &unit) mutable {
+      hash.feed(unit.pos).feed(unit.dest);
+      hash.feed(unit.moving_speed).feed(unit.facing).feed(unit.facing_dest);
+    };
+    feed_unit(ball.unit);
+    hash.feed(ball.vertical_speed).feed(ball.is_in_air).feed(ball.current_owner);
+    for(const auto &p : players) {
+      feed_unit(p.unit);
+      hash.feed(p.vertical_speed).feed(p.is_in_air).feed(p.has_ball);
+    }
+    return hash.value;
+  }
+
   Team &get_team(int playerId) {
     return (playerId < team1.size()) ? team1 : team2;
   }
@@ -281,7 +327,7 @@ struct Soccer {
       p.kick_the_ball(ball, 300. * Unit::GAUGE, 20. * Unit::GAUGE, direction);
     } else if(p.can_slide()) {
       p.timestamp_slide();
-      Unit::vec_t slide_vec(std::cos(direction), std::sin(direction), 0);
+      Unit::vec_t slide_vec(det::cos(direction), det::sin(direction), 0);
       slide_vec *= p.slide_speed * p.slide_duration;
       p.unit.slide(p.unit.pos + slide_vec, p.slide_duration);
     }
@@ -14,12 +14,13 @@
 
 #include "Soccer.hpp"
 #include "Intelligence.hpp"
+#include "Trace.hpp"
 
 struct SoccerObject {
   Soccer &soccer;
   Intelligence<IntelligenceType::ABSTRACT> &intelligence;
 
-  std::vector<PlayerObject *> playerObjs;
+  PlayerObject playerObj;
   PitchObject pitchObj;
   PostObject postObjRed, postObjBlue;
   BallObject ballObj;
@@ -27,25 +28,19 @@ struct SoccerObject {
   SoccerObject(Soccer &soccer, Intelligence<IntelligenceType::ABSTRACT> &intelligence, const std::string &dir):
     soccer(soccer),
     intelligence(intelligence),
-    playerObjs(soccer.team1.size() + soccer.team2.size(), nullptr),
+    playerObj(dir),
     pitchObj(dir),
     postObjRed(Soccer::Team::RED_TEAM, dir),
     postObjBlue(Soccer::Team::BLUE_TEAM, dir),
     ballObj(dir)
-  {
-    for(size_t i = 0; i < playerObjs.size(); ++i) {
-      playerObjs[i] = new PlayerObject(dir);
-    }
-  }
+  {}
 
   void init() {
     pitchObj.init();
     postObjRed.init();
     postObjBlue.init();
     ballObj.init();
-    for(PlayerObject *p : playerObjs) {
-      p->init();
-    }
+    playerObj.init();
   }
 
   enum class CursorState {
@@ -137,35 +132,18 @@ struct SoccerObject {
     }
   }
 
-  void display(Camera &cam) {
-    pitchObj.display(cam);
-    postObjRed.display(cam);
-    postObjBlue.display(cam);
+  void submit(gl::RenderQueue &queue, Camera &cam) {
+    TRACE_SCOPE("SoccerObject: submit");
+    pitchObj.submit(queue, cam);
+    postObjRed.submit(queue, cam);
+    postObjBlue.submit(queue, cam);
     std::lock_guard<std::recursive_mutex> guard(soccer.mtx);
-    ballObj.display(soccer.ball, cam);
-
-    std::vector<int> indices(soccer.players.size());
-    for(int i = 0; i < soccer.players.size(); ++i) {
-      indices[i] = i;
-    }
-    // sort by Y coordinate as we want to see the closest.
-    for(int i = 0; i < soccer.players.size() - 1; ++i) {
-      for(int j = i + 1; j < soccer.players.size(); ++j) {
-        if(soccer.get_player(indices[i]).unit.pos.y > soccer.get_player(indices[j]).unit.pos.y) {
-          std::swap(indices[i], indices[j]);
-        }
-      }
-    }
-    for(auto &ind: indices) {
-      playerObjs[ind]->display(soccer.get_player(ind), cam);
-    }
+    ballObj.submit(queue, soccer.ball, cam);
+    playerObj.submit(queue, soccer.players, cam);
   }
 
   void clear() {
-    for(PlayerObject *p : playerObjs) {
-      p->clear();
-      delete p;
-    }
+    playerObj.clear();
     ballObj.clear();
     postObjRed.clear();
     postObjBlue.clear();
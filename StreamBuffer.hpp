@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <incgraphics.h>
+#include <Debug.hpp>
+#include <Logger.hpp>
+#include <GLState.hpp>
+
+namespace gl {
+// vertex data rewritten every frame, e.g. instance matrices. one array
+// buffer split into a segment per frame in flight: a frame writes into its
+// own segment through an unsynchronized map, so the driver never waits for
+// the draws reading the other segments, and a fence put at the end of the
+// frame tells when its segment can be written again. if the GPU is still
+// using a segment when its turn comes, the buffer is orphaned rather than
+// waited for. GL 3.2 has no persistent mapping: the rest of the segment is
+// mapped at the first write and the writes are sub-allocated from it, until
+// unmap() before the draws reading them
+struct StreamBuffer {
+  static constexpr int NO_SEGMENTS = 3;
+  // all the data of a frame has to fit
+  static constexpr size_t SEGMENT_SIZE = 1 << 20;
+  static constexpr size_t SIZE = NO_SEGMENTS * SEGMENT_SIZE;
+
+  static inline GLuint vbo = 0;
+  static inline GLsync fences[NO_SEGMENTS] = {nullptr, nullptr, nullptr};
+  static inline int segment = 0;
+  static inline size_t head = 0;
+  // the mapped range starts at map_offset, nullptr while unmapped
+  static inline char *mapped = nullptr;
+  static inline size_t map_offset = 0;
+
+  static inline uint64_t no_bytes = 0;
+  static inline uint64_t no_orphaned = 0;
+
+  static void init() {
+    if(vbo != 0)return;
+    glGenBuffers(1, &vbo); GLERROR
+    gl::State::bind_buffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, SIZE, nullptr, GL_STREAM_DRAW); GLERROR
+    segment = 0;
+    head = 0;
+  }
+
+  static GLuint id() {
+    init();
+    return vbo;
+  }
+
+  static void bind() {
+    gl::State::bind_buffer(GL_ARRAY_BUFFER, id());
+  }
+
+  static void delete_fences() {
+    for(int i = 0; i < NO_SEGMENTS; ++i) {
+      if(fences[i] == nullptr)continue;
+      glDeleteSync(fences[i]); GLERROR
+      fences[i] = nullptr;
+    }
+  }
+
+  // fresh storage under the same name, the old one is freed by the driver
+  // once the draws reading it are done. only safe between frames: the draws
+  // of the current frame may not be issued yet
+  static void orphan() {
+    bind();
+    glBufferData(GL_ARRAY_BUFFER, SIZE, nullptr, GL_STREAM_DRAW); GLERROR
+    delete_fences();
+    ++no_orphaned;
+  }
+
+  // copies bytes into the segment of this frame at a multiple of align and
+  // returns the offset. with align the size of a vertex, offset / align is
+  // the first vertex to draw
+  static size_t write(const void *data, size_t bytes, size_t align) {
+    const size_t offset = (head + align - 1) / align * align;
+    const size_t end = (segment + 1) * SEGMENT_SIZE;
+    ASSERT(offset + bytes <= end);
+    if(bytes == 0)return offset;
+    if(mapped == nullptr) {
+      bind();
+      map_offset = head;
+      mapped = (char *)glMapBufferRange(GL_ARRAY_BUFFER, map_offset, end - map_offset,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT); GLERROR
+      ASSERT(mapped != nullptr);
+    }
+    memcpy(mapped + (offset - map_offset), data, bytes);
+    head = offset + bytes;
+    no_bytes += bytes;
+    return offset;
+  }
+
+  template <typename T>
+  static size_t write(const std::vector<T> &data, size_t align=sizeof(T)) {
+    return write(data.data(), data.size() * sizeof(T), align);
+  }
+
+  // before drawing what was written: a buffer can't be drawn from while it
+  // is mapped. only the written part is flushed
+  static void unmap() {
+    if(mapped == nullptr)return;
+    bind();
+    glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, head - map_offset); GLERROR
+    glUnmapBuffer(GL_ARRAY_BUFFER); GLERROR
+    mapped = nullptr;
+  }
+
+  // after the draws of a frame
+  static void end_frame() {
+    if(vbo == 0)return;
+    unmap();
+    fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); GLERROR
+    segment = (segment + 1) % NO_SEGMENTS;
+    head = segment * SEGMENT_SIZE;
+    if(fences[segment] == nullptr)return;
+    const GLenum rc = glClientWaitSync(fences[segment], 0, 0); GLERROR
+    if(rc == GL_ALREADY_SIGNALED || rc == GL_CONDITION_SATISFIED) {
+      glDeleteSync(fences[segment]); GLERROR
+      fences[segment] = nullptr;
+    } else {
+      LOG(WARNING, GRAPHICS, "stream buffer: segment %d still in use, orphaning\n", segment);
+      orphan();
+    }
+  }
+
+  static void clear() {
+    if(vbo == 0)return;
+    unmap();
+    delete_fences();
+    glDeleteBuffers(1, &vbo); GLERROR
+    gl::State::forget_buffer(vbo);
+    vbo = 0;
+  }
+};
+} // namespace gl
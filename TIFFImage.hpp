@@ -32,7 +32,7 @@ struct TIFFImage : public Image {
         TIFFError("error: filename '%s', err=%d\n", filename.c_str(), error);
         TERMINATE("tiff: terminating\n");
       }
-      Logger::Info("read tiff image %s (%d x %d)\n", filename.c_str(), img.width, img.height);
+      LOG(INFO, GRAPHICS, "read tiff image %s (%d x %d)\n", filename.c_str(), img.width, img.height);
     } else {
       TIFFError("error: filename '%s', err=%d\n", filename.c_str(), error);
       TERMINATE("tiff: terminating\n");
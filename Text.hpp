@@ -2,6 +2,7 @@
 
 #include <cctype>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "incgraphics.h"
@@ -27,6 +28,10 @@ struct Text {
   gl::Buffer<GL_ARRAY_BUFFER, gl::BufferElementType::VEC4> buf;
   gl::Attrib<decltype(buf)> attr;
   gl::VertexArray<decltype(attr)> vao;
+  size_t no_vertices = 0;
+  // the buffer holds the quads of str laid out with this atlas
+  const Font::Atlas *laid_out = nullptr;
+  bool changed = true;
   float width_ = 0, height_ = 0;
 
   using ShaderBuffer = decltype(buf);
@@ -51,14 +56,15 @@ struct Text {
   float yscale = 1./1024;
   float xscale = yscale;
 
-  void set_text(std::string s) {
+  void set_text(const std::string &s) {
+    if(s == str && !changed)return;
     str = s;
+    changed = true;
     width_ = height_ = 0;
     for(int i = 0; i < s.length(); ++i) {
       char c = s[i];
       ASSERT(isascii(c));
-      ASSERT(font.alphabet.find(c) != font.alphabet.end());
-      Font::Character &ch = font.alphabet.at(c);
+      const Font::Character &ch = font.glyph(c);
       width_ += ch.size.x + ch.bearing.x,
       height_ += ch.size.y - ch.bearing.y;
       if(i < s.length() - 1) {
@@ -67,10 +73,8 @@ struct Text {
     }
   }
 
-  template <typename... ShaderTs>
-  void init(gl::ShaderProgram<ShaderTs...> &program) {
-    using ShaderProgram = gl::ShaderProgram<ShaderTs...>;
-
+  // for a program which is already compiled, e.g. shared with another text
+  void init() {
     ShaderBuffer::init(buf);
     buf.allocate_with_overlap<GL_DYNAMIC_DRAW>(std::vector<float>(6*4, 0));
 
@@ -78,10 +82,55 @@ struct Text {
     attr.select_buffer(buf);
     vao.enable(attr);
     vao.set_access(attr, 0);
+  }
 
+  template <typename... ShaderTs>
+  void init(gl::ShaderProgram<ShaderTs...> &program) {
+    using ShaderProgram = gl::ShaderProgram<ShaderTs...>;
+
+    init();
     ShaderProgram::init(program, vao);
   }
 
+  // the quads of all characters in glyph pixels, position and scale are left
+  // to the transform. only redone when the string or the atlas changes
+  void layout() {
+    std::vector<GLfloat> vertices;
+    vertices.reserve(str.length() * 6*4);
+    float x = 0, y = 0;
+    for(char c : str) {
+      ASSERT(isascii(c));
+      const Font::Character &ch = font.glyph(c);
+      GLfloat
+        posx = x + ch.bearing.x,
+        posy = y - (ch.size.y - ch.bearing.y);
+      GLfloat
+        w = ch.size.x,
+        h = ch.size.y;
+      GLfloat
+        u1 = ch.uv_min.x, v1 = ch.uv_min.y,
+        u2 = ch.uv_max.x, v2 = ch.uv_max.y;
+      vertices.insert(vertices.end(), {
+        posx,     posy + h,   u1, v1,
+        posx,     posy,       u1, v2,
+        posx + w, posy,       u2, v2,
+
+        posx,     posy + h,   u1, v1,
+        posx + w, posy,       u2, v2,
+        posx + w, posy + h,   u2, v1,
+      });
+      x += (ch.advance >> 6);
+    }
+    if(vertices.size() > buf.numberOfScalars) {
+      buf.allocate_with_overlap<GL_DYNAMIC_DRAW>(vertices);
+    } else if(!vertices.empty()) {
+      buf.set_subdata(vertices);
+    }
+    no_vertices = vertices.size() / 4;
+    laid_out = font.atlas;
+    changed = false;
+  }
+
   enum class Positioning {
     LEFT, CENTER
   };
@@ -91,9 +140,8 @@ struct Text {
 
     ShaderProgram::use(program);
 
-    glEnable(GL_BLEND); GLERROR
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); GLERROR
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO); GLERROR
+    gl::State::enable(GL_BLEND);
+    gl::State::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 
     uTextColor.set_id(program.id());
     uTextColor.set_data(color);
@@ -106,37 +154,21 @@ struct Text {
     uTransform.set_id(program.id());
     uTransform.set_data(matrix);
 
-    gl::Texture::set_active(0);
-    VertexArray::bind(vao);
-    float x = 0, y = 0;
     /* if(pst == Positioning::CENTER) { */
     /*   transform.MovePosition(-.5*width(), .5*height(), 0); */
     /* } */
-    for(char c : str) {
-      ASSERT(isascii(c));
-      ASSERT(font.alphabet.find(c) != font.alphabet.end());
-      Font::Character &ch = font.alphabet.at(c);
-      GLfloat
-        posx = x + ch.bearing.x,
-        posy = y - (ch.size.y - ch.bearing.y);
-      GLfloat
-        w = ch.size.x,
-        h = ch.size.y;
-      std::vector<GLfloat> vertices = {
-        posx,     posy + h,   0.0, 0.0,
-        posx,     posy,       0.0, 1.0,
-        posx + w, posy,       1.0, 1.0,
-
-        posx,     posy + h,   0.0, 0.0,
-        posx + w, posy,       1.0, 1.0,
-        posx + w, posy + h,   1.0, 0.0,
-      };
-      ch.tex.uSampler.set_id(program.id());
-      gl::Texture::bind(ch.tex);
-      ch.tex.set_data(0);
-      buf.set_subdata(vertices);
-      VertexArray::draw<GL_TRIANGLES>(vao, 0, 6);
-      x += (ch.advance >> 6);
+    if(changed || laid_out != font.atlas) {
+      layout();
+    }
+
+    gl::Texture &tex = font.texture();
+    gl::Texture::set_active(0);
+    gl::Texture::bind(tex);
+    tex.uSampler.set_id(program.id());
+    tex.set_data(0);
+    VertexArray::bind(vao);
+    if(no_vertices > 0) {
+      VertexArray::draw<GL_TRIANGLES>(vao, 0, no_vertices);
     }
     VertexArray::unbind();
     gl::Texture::unbind();
@@ -146,7 +178,7 @@ struct Text {
     transform.SetScale(init_scale);
     /* transform.SetPosition(init_pos); */
 
-    glDisable(GL_BLEND); GLERROR
+    gl::State::disable(GL_BLEND);
 
     ShaderProgram::unuse();
   }
@@ -155,6 +187,8 @@ struct Text {
     ShaderAttrib::clear(attr);
     ShaderBuffer::clear(buf);
     VertexArray::clear(vao);
+    laid_out = nullptr;
+    changed = true;
   }
 };
 } // namespace ui
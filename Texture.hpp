@@ -1,19 +1,25 @@
 #pragma once
 
 #include <string>
+#include <memory>
 
 #include "incgraphics.h"
 #include "incfreetype.h"
 
 #include "ShaderProgram.hpp"
 #include "ShaderUniform.hpp"
+#include "GLState.hpp"
 
 #include "ImageLoader.hpp"
+#include "AssetPack.hpp"
+#include "Loader.hpp"
 
 namespace gl {
 struct Texture {
   GLuint tex;
   gl::Uniform<gl::UniformType::SAMPLER2D> uSampler;
+  // the loader task of init_async(), if any
+  uint64_t loading = 0;
 
   Texture(std::string uniform_name):
     uSampler(uniform_name.c_str())
@@ -50,36 +56,88 @@ struct Texture {
     delete [] image;
   }
 
+  // the image and its mip chain as they are in the asset pack, into the
+  // bound texture. false if the pack doesn't have it
+  static bool load_packed(const std::string &filename) {
+    const AssetPack::Entry *e = AssetPack::find(filename, AssetPack::Type::TEXTURE);
+    if(e == nullptr)return false;
+    const auto *header = AssetPack::at<AssetPack::TextureHeader>(e);
+    const auto *levels = AssetPack::at<AssetPack::TextureLevel>(e, sizeof(AssetPack::TextureHeader));
+    const GLenum pixel_format = get_gl_pixel_format(img::Image::Format(header->format));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); GLERROR
+    for(uint32_t i = 0; i < header->no_levels; ++i) {
+      glTexImage2D(GL_TEXTURE_2D, i, pixel_format, levels[i].width, levels[i].height, 0, pixel_format, GL_UNSIGNED_BYTE, AssetPack::at<GLubyte>(e, levels[i].offset)); GLERROR
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->no_levels - 1); GLERROR
+    return true;
+  }
+
+  // decoded here, unless the asset pack has it
+  static img::Image *decode(const std::string &filename) {
+    if(AssetPack::find(filename, AssetPack::Type::TEXTURE) != nullptr)return nullptr;
+    sys::File file(filename.c_str());
+    return img::load_image(file);
+  }
+
   void init(const std::string &filename) {
     /* init(); return; */
     /* long c=clock(); */
-    Logger::Info("Loading texture '%s'\n", filename.c_str());
-    sys::File file(filename.c_str());
-    /* c=clock(); */
-    img::Image *image = img::load_image(file);
-    /* Logger::Info("load image '%s': %ld\n", filename.c_str(), clock()-c); */
-    /* std::cout << "load image '" << filename << "': " << clock()-c << std::endl; */
-    /* c=clock(); */
+    LOG(INFO, GRAPHICS, "Loading texture '%s'\n", filename.c_str());
     glGenTextures(1, &tex); GLERROR
-    gl::Texture::bind(tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, get_gl_pixel_format(image->format), image->width, image->height, 0, get_gl_pixel_format(image->format), GL_UNSIGNED_BYTE, image->data); GLERROR
+    std::unique_ptr<img::Image> image(decode(filename));
+    upload(tex, filename, image.get());
+    /* Logger::Info("create texture '%s': %ld\n", filename.c_str(), clock()-c); */
+    /* std::cout << "create texture '" << filename << "': " << clock()-c << std::endl; */
+    LOG(INFO, GRAPHICS, "Finished loading texture '%s'.\n", filename.c_str());
+  }
+
+  // the name is there at once and the image is decoded by the loader. until
+  // it is uploaded the texture is incomplete and samples as black
+  void init_async(const std::string &filename) {
+    LOG(INFO, GRAPHICS, "Loading texture '%s' in the background\n", filename.c_str());
+    glGenTextures(1, &tex); GLERROR
+    const GLuint id = tex;
+    auto image = std::make_shared<std::unique_ptr<img::Image>>();
+    loading = Loader::load([filename, image]() -> void {
+      image->reset(decode(filename));
+    }, [id, filename, image]() -> bool {
+      upload(id, filename, image->get());
+      image->reset();
+      LOG(INFO, GRAPHICS, "Finished loading texture '%s'.\n", filename.c_str());
+      return true;
+    });
+  }
+
+  bool ready() const {
+    return loading == 0 || !Loader::is_pending(loading);
+  }
+
+  // from the image if it is decoded, else from the asset pack or the file
+  static void upload(GLuint id, const std::string &filename, const img::Image *image) {
+    gl::Texture::bind(id);
+    if(image != nullptr || !load_packed(filename)) {
+      std::unique_ptr<img::Image> decoded;
+      if(image == nullptr) {
+        sys::File file(filename.c_str());
+        decoded.reset(img::load_image(file));
+        image = decoded.get();
+      }
+      glTexImage2D(GL_TEXTURE_2D, 0, get_gl_pixel_format(image->format), image->width, image->height, 0, get_gl_pixel_format(image->format), GL_UNSIGNED_BYTE, image->data); GLERROR
+      glGenerateMipmap(GL_TEXTURE_2D); GLERROR
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); GLERROR
-    glGenerateMipmap(GL_TEXTURE_2D); GLERROR
     gl::Texture::unbind();
-    /* Logger::Info("create texture '%s': %ld\n", filename.c_str(), clock()-c); */
-    /* std::cout << "create texture '" << filename << "': " << clock()-c << std::endl; */
-    delete image;
-    Logger::Info("Finished loading texture '%s'.\n", filename.c_str());
   }
 
-  void init(FT_GlyphSlot *glyph) {
+  // single channel, e.g. a glyph atlas
+  void init(GLsizei width, GLsizei height, const GLubyte *data) {
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1); GLERROR
     glGenTextures(1, &tex); GLERROR
     gl::Texture::bind(tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, (*glyph)->bitmap.width, (*glyph)->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, (*glyph)->bitmap.buffer); GLERROR
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); GLERROR
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); GLERROR
@@ -88,7 +146,7 @@ struct Texture {
   }
 
   static void set_active(int index=0) {
-    glActiveTexture(GL_TEXTURE0 + index); GLERROR
+    gl::State::set_active_texture(index);
   }
 
   static GLint get_active_texture() {
@@ -98,7 +156,7 @@ struct Texture {
   }
 
   static void bind(GLuint texId) {
-    glBindTexture(GL_TEXTURE_2D, texId); GLERROR
+    gl::State::bind_texture(texId);
   }
 
   static void bind(gl::Texture &tx) {
@@ -114,11 +172,12 @@ struct Texture {
   }
 
   static void unbind() {
-    glBindTexture(GL_TEXTURE_2D, 0); GLERROR
+    gl::State::unbind_texture();
   }
 
   static void clear(GLuint &texId) {
     glDeleteTextures(1, &texId); GLERROR
+    gl::State::forget_texture(texId);
   }
 
   static void clear(gl::Texture &tx) {
@@ -126,6 +185,8 @@ struct Texture {
   }
 
   void clear() {
+    Loader::cancel(loading);
+    loading = 0;
     clear(tex);
   }
 };
@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <climits>
 #include <map>
+#include <atomic>
 #include <deque>
 #include <chrono>
 #include <limits>
@@ -21,12 +22,25 @@ struct Timer {
     return .0;
   }
 
+  using clock_t = std::chrono::steady_clock;
+  static inline const clock_t::time_point clock_start = clock_t::now();
+
+  // seconds since the program started. monotonic, so it doesn't jump with
+  // the wall clock, and lock-free: safe to call from every thread
   static time_t system_time() {
-    static std::mutex mtx;
-    static auto systime_start = std::chrono::system_clock::now();
-    std::lock_guard<std::mutex> guard(mtx);
-    auto systime_now = std::chrono::system_clock::now();
-    return 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(systime_now - systime_start).count();
+    return std::chrono::duration<time_t>(clock_t::now() - clock_start).count();
+  }
+
+  // sampled once per frame by the render loop, for whatever only needs to
+  // know when the current frame started
+  static inline std::atomic<time_t> frame_time_{time_start()};
+
+  static void update_frame_time() {
+    frame_time_.store(system_time(), std::memory_order_relaxed);
+  }
+
+  static time_t frame_time() {
+    return frame_time_.load(std::memory_order_relaxed);
   }
 
   time_t prev_time = time_start();
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Debug.hpp"
+#include "Logger.hpp"
+
+#include "incgraphics.h"
+
+namespace gl {
+// GL_TIME_ELAPSED queries which are read back a few frames later, so that
+// waiting for a result never stalls the pipeline. every query carries a tag
+// telling what it measured
+template <size_t N = 4>
+struct TimerQuery {
+  GLuint ids[N] = {0};
+  uint64_t tags[N];
+  bool pending[N] = {false};
+  size_t current = 0;
+  bool active = false;
+
+  TimerQuery()
+  {}
+
+  static void init(gl::TimerQuery<N> &query) {
+    query.init();
+  }
+
+  void init() {
+    glGenQueries(N, ids); GLERROR
+  }
+
+  // skips the measurement if the oldest query is still in flight
+  void begin(uint64_t tag) {
+    ASSERT(!active);
+    if(pending[current])return;
+    glBeginQuery(GL_TIME_ELAPSED, ids[current]); GLERROR
+    tags[current] = tag;
+    active = true;
+  }
+
+  void end() {
+    if(!active)return;
+    glEndQuery(GL_TIME_ELAPSED); GLERROR
+    pending[current] = true;
+    current = (current + 1) % N;
+    active = false;
+  }
+
+  // calls func(tag, milliseconds) for every query which has finished
+  template <typename F>
+  void poll(F &&func) {
+    for(size_t i = 0; i < N; ++i) {
+      const size_t j = (current + i) % N;
+      if(!pending[j])continue;
+      GLint available = 0;
+      glGetQueryObjectiv(ids[j], GL_QUERY_RESULT_AVAILABLE, &available); GLERROR
+      if(!available)break;
+      GLuint64 nanoseconds = 0;
+      glGetQueryObjectui64v(ids[j], GL_QUERY_RESULT, &nanoseconds); GLERROR
+      pending[j] = false;
+      func(tags[j], nanoseconds * 1e-6);
+    }
+  }
+
+  static void clear(gl::TimerQuery<N> &query) {
+    query.clear();
+  }
+
+  void clear() {
+    glDeleteQueries(N, ids); GLERROR
+  }
+};
+}
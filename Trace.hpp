@@ -0,0 +1,212 @@
+#pragma once
+
+// scoped trace zones and counters, exported as chrome trace json which
+// can be opened in perfetto or chrome://tracing. compiled in with
+// COMPILE_TRACE only, otherwise the macros expand to nothing:
+//
+//   TRACE_THREAD("iclient");          names the calling thread
+//   TRACE_SCOPE("soccer: idle");      times the enclosing scope
+//   TRACE_COUNTER("frames", n);       samples a value
+//   TRACE_DUMP("minififa.trace.json");
+//
+// names must be string literals, only their address is recorded
+
+#ifdef COMPILE_TRACE
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <string>
+
+#include "Logger.hpp"
+
+namespace trace {
+
+struct Event {
+  enum class Type : uint8_t {
+    ZONE, COUNTER
+  };
+  const char *name;
+  Type type;
+  uint64_t start;
+  union {
+    uint64_t duration;
+    double value;
+  };
+};
+
+// written by the owning thread only, read when dumping. a ring: once it is
+// full, the oldest events are overwritten
+struct ThreadBuffer {
+  static constexpr size_t CAPACITY = 1 << 16;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0);
+  uint32_t tid;
+  const char *thread_name = nullptr;
+  std::unique_ptr<Event[]> events;
+  std::atomic<size_t> no_pushed{0};
+
+  explicit ThreadBuffer(uint32_t tid):
+    tid(tid), events(new Event[CAPACITY])
+  {}
+
+  void push(const Event &event) {
+    const size_t i = no_pushed.load(std::memory_order_relaxed);
+    events[i & (CAPACITY - 1)] = event;
+    no_pushed.store(i + 1, std::memory_order_release);
+  }
+
+  // copies the events still in the ring, oldest first, and returns how many
+  // were overwritten. the owner may keep pushing meanwhile, whatever it
+  // overwrote during the copy is left out
+  size_t copy(std::vector<Event> &out) const {
+    const size_t end = no_pushed.load(std::memory_order_acquire);
+    const size_t begin = end > CAPACITY ? end - CAPACITY : 0;
+    out.clear();
+    out.reserve(end - begin);
+    for(size_t i = begin; i < end; ++i) {
+      out.push_back(events[i & (CAPACITY - 1)]);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const size_t now = no_pushed.load(std::memory_order_relaxed);
+    const size_t first_valid = now > CAPACITY ? now - CAPACITY : 0;
+    if(first_valid <= begin) {
+      return begin;
+    }
+    out.erase(std::begin(out), std::begin(out) + std::min(first_valid - begin, out.size()));
+    return first_valid;
+  }
+};
+
+struct Registry {
+  std::mutex mtx;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+  static Registry &get() {
+    static Registry registry;
+    return registry;
+  }
+
+  ThreadBuffer *make_buffer() {
+    std::lock_guard<std::mutex> guard(mtx);
+    buffers.emplace_back(new ThreadBuffer(buffers.size() + 1));
+    return buffers.back().get();
+  }
+};
+
+inline uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - Registry::get().epoch
+  ).count();
+}
+
+inline ThreadBuffer &thread_buffer() {
+  thread_local ThreadBuffer *buffer = Registry::get().make_buffer();
+  return *buffer;
+}
+
+inline void set_thread_name(const char *name) {
+  thread_buffer().thread_name = name;
+}
+
+inline void counter(const char *name, double value) {
+  Event event;
+  event.name = name;
+  event.type = Event::Type::COUNTER;
+  event.start = now();
+  event.value = value;
+  thread_buffer().push(event);
+}
+
+struct Zone {
+  const char *name;
+  uint64_t start;
+
+  explicit Zone(const char *name):
+    name(name), start(now())
+  {}
+
+  ~Zone() {
+    Event event;
+    event.name = name;
+    event.type = Event::Type::ZONE;
+    event.start = start;
+    event.duration = now() - start;
+    thread_buffer().push(event);
+  }
+};
+
+inline void write_string(FILE *fp, const char *s) {
+  fputc('"', fp);
+  for(; *s != '\0'; ++s) {
+    if(*s == '"' || *s == '\\') {
+      fputc('\\', fp);
+    }
+    fputc(*s, fp);
+  }
+  fputc('"', fp);
+}
+
+// timestamps in the trace format are in microseconds
+inline void dump(const std::string &filename) {
+  FILE *fp = fopen(filename.c_str(), "w");
+  if(fp == nullptr) {
+    LOG(ERROR, GENERAL, "trace: unable to open '%s'\n", filename.c_str());
+    return;
+  }
+  Registry &registry = Registry::get();
+  std::lock_guard<std::mutex> guard(registry.mtx);
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  size_t no_events = 0, no_overwritten = 0;
+  std::vector<Event> events;
+  for(const auto &buffer : registry.buffers) {
+    if(buffer->thread_name != nullptr) {
+      fprintf(fp, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->tid);
+      write_string(fp, buffer->thread_name);
+      fprintf(fp, "}}");
+      first = false;
+    }
+    no_overwritten += buffer->copy(events);
+    for(const Event &event : events) {
+      fprintf(fp, "%s{\"name\":", first ? "" : ",\n");
+      write_string(fp, event.name);
+      if(event.type == Event::Type::ZONE) {
+        fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+          buffer->tid, event.start * 1e-3, event.duration * 1e-3);
+      } else {
+        fprintf(fp, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%g}}",
+          buffer->tid, event.start * 1e-3, event.value);
+      }
+      first = false;
+    }
+    no_events += events.size();
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  LOG(INFO, GENERAL, "trace: wrote %lu events to '%s', %lu older ones were overwritten\n", no_events, filename.c_str(), no_overwritten);
+}
+
+} // namespace trace
+
+#define TRACE_CONCAT_(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_(A, B)
+#define TRACE_THREAD(NAME) trace::set_thread_name(NAME)
+#define TRACE_SCOPE(NAME) trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(NAME)
+#define TRACE_COUNTER(NAME, VALUE) trace::counter(NAME, VALUE)
+#define TRACE_DUMP(FILENAME) trace::dump(FILENAME)
+
+#else
+
+#define TRACE_THREAD(NAME)
+#define TRACE_SCOPE(NAME)
+#define TRACE_COUNTER(NAME, VALUE)
+#define TRACE_DUMP(FILENAME)
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "Debug.hpp"
 #include "Timer.hpp"
+#include "Deterministic.hpp"
 
 struct Unit {
   static constexpr float GAUGE = .0004;
@@ -79,7 +80,7 @@ struct Unit {
   }
 
   float facing_angle(loc_t location) {
-    return atan2(location.y - pos.y, location.x - pos.x);
+    return det::atan2(location.y - pos.y, location.x - pos.x);
   }
 
   void face(loc_t location) {
@@ -114,8 +115,8 @@ struct Unit {
 
   vec_t point_offset(real_t offset, float angle) const {
     return pos + offset * vec_t(
-      std::cos(angle),
-      std::sin(angle),
+      det::cos(angle),
+      det::sin(angle),
       height()
     );
   }
@@ -128,16 +129,10 @@ struct Unit {
     return length(dest - pos) > .0001;
   }
 
-  void idle_moving() {
-    if(!is_moving())return;
-    /* printf("pos: %f %f %f\n", pos.x, pos.y, pos.z); */
-    real_t timediff = timer.elapsed();
+  // where a unit ends up after timediff when heading straight for dest;
+  // the server uses it to tell what the clients extrapolate between syncs
+  static loc_t extrapolate(loc_t pos, loc_t dest, real_t moving_speed, time_t timediff) {
     auto dir = vec_t(dest.x - pos.x, dest.y - pos.y, 0);
-    /* printf("pos: %f %f %f\n", pos.x, pos.y, pos.z); */
-    /* printf("dest: %f %f %f\n", dest.x, dest.y, dest.z); */
-    /* printf("dir: %f %f %f\n", dir.x, dir.y, dir.z); */
-    /* printf("timediff: %f\n", timediff); */
-    /* printf("moving_speed: %f\n", moving_speed); */
     real_t step = timediff * moving_speed;
     if(length(dir) <= step) {
       pos.x = dest.x;
@@ -145,8 +140,15 @@ struct Unit {
     } else {
       dir *= step / length(dir);
       pos += dir;
-      /* printf("facing angle: %f\n", facing_dest); */
     }
+    return pos;
+  }
+
+  void idle_moving() {
+    if(!is_moving())return;
+    /* printf("pos: %f %f %f\n", pos.x, pos.y, pos.z); */
+    real_t timediff = timer.elapsed();
+    pos = extrapolate(pos, dest, moving_speed, timediff);
     /* printf("pos: %f %f %f\n", pos.x, pos.y, pos.z); */
   }
 };
@@ -5,6 +5,7 @@
 #include <Debug.hpp>
 #include <Logger.hpp>
 #include <Tuple.hpp>
+#include <GLState.hpp>
 
 #include <ShaderAttrib.hpp>
 
@@ -40,7 +41,7 @@ struct VertexArray {
   }
 
   static void bind(GLuint vao) {
-    glBindVertexArray(vao); GLERROR
+    gl::State::bind_vertex_array(vao);
   }
 
   static void bind(self_t &vao) {
@@ -87,6 +88,29 @@ struct VertexArray {
     this->unbind();
   }
 
+  // a mat4 attribute taken from buf once per instance, one column in each of
+  // the four locations starting at location
+  template <typename BufferT>
+  void set_instanced_mat4(GLuint location, const BufferT &buf) {
+    set_instanced_mat4(location, buf.id(), 0);
+  }
+
+  // the matrices start at offset in vbo, there is no base instance to draw
+  // from in GL 3.2
+  void set_instanced_mat4(GLuint location, GLuint vbo, size_t offset) {
+    this->bind();
+
+    gl::State::bind_buffer(GL_ARRAY_BUFFER, vbo);
+    for(GLuint i = 0; i < 4; ++i) {
+      glEnableVertexAttribArray(location + i); GLERROR
+      glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(offset + i * sizeof(glm::vec4))); GLERROR
+      glVertexAttribDivisor(location + i, 1); GLERROR
+    }
+    gl::State::unbind_buffer(GL_ARRAY_BUFFER);
+
+    this->unbind();
+  }
+
   template <typename AttribT>
   void disable(const AttribT &attrib) {
     this->bind();
@@ -112,6 +136,13 @@ struct VertexArray {
     this->unbind();
   }
 
+  template <GLenum PRIMITIVES>
+  void draw_instanced(size_t start, size_t no_primitives, size_t no_instances) {
+    this->bind();
+    glDrawArraysInstanced(PRIMITIVES, start, no_primitives, no_instances); GLERROR
+    this->unbind();
+  }
+
   template <GLenum PRIMITIVES, typename... ShaderTs>
   void draw(gl::ShaderProgram<ShaderTs...> &prog, size_t start=0, size_t no_primitives=SIZE_MAX) {
     gl::ShaderProgram<ShaderTs...>::use(prog);
@@ -130,11 +161,12 @@ struct VertexArray {
   }
 
   static void unbind() {
-    glBindVertexArray(0); GLERROR
+    gl::State::unbind_vertex_array();
   }
 
   static void clear(GLuint &vao) {
     glDeleteVertexArrays(1, &vao); GLERROR
+    gl::State::forget_vertex_array(vao);
   }
 
   static void clear(VertexArray &va) {
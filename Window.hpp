@@ -13,7 +13,12 @@
 #include "Transformation.hpp"
 #include "ImageLoader.hpp"
 #include "Logger.hpp"
+#include "Trace.hpp"
 #include "Debug.hpp"
+#include "GLState.hpp"
+#include "StreamBuffer.hpp"
+#include "Assets.hpp"
+#include "Loader.hpp"
 
 #include "Region.hpp"
 #include "ClientObject.hpp"
@@ -40,6 +45,8 @@ protected:
   glm::vec2 cursor_pos{0, 0};
   ClientObject cObject;
   std::string dir;
+  // what the loader may upload in a frame, in seconds
+  static constexpr Timer::time_t UPLOAD_BUDGET = .002;
 
   void start() {
     init_glfw();
@@ -67,6 +74,7 @@ protected:
     ASSERT(window != nullptr);
     window_reference[window] = this;
     glfwMakeContextCurrent(window); GLERROR
+    gl::State::reset();
     glfwSetKeyCallback(window, glfw::keypress_callback); GLERROR
     glfwSetWindowSizeCallback(window, glfw::size_callback); GLERROR
     glfwSetCursorPosCallback(window, glfw::cursor_area_callback); GLERROR
@@ -94,40 +102,50 @@ public:
     // get version info
     const GLubyte* renderer = glGetString(GL_RENDERER); GLERROR // get renderer string
     const GLubyte* version = glGetString(GL_VERSION); GLERROR // version as a string
-    Logger::Info("Renderer: %s\n", renderer);
-    Logger::Info("OpenGL version supported %s\n", version);
-    Logger::Info("Supported OpenGL extensions:\n");
+    LOG(INFO, GRAPHICS, "Renderer: %s\n", renderer);
+    LOG(INFO, GRAPHICS, "OpenGL version supported %s\n", version);
+    LOG(INFO, GRAPHICS, "Supported OpenGL extensions:\n");
     GLint no_exts;
     glGetIntegerv(GL_NUM_EXTENSIONS, &no_exts);
     for(GLint i = 0; i < no_exts; ++i) {
-      Logger::Info("\t%s\n", glGetStringi(GL_EXTENSIONS, i));
+      LOG(INFO, GRAPHICS, "\t%s\n", glGetStringi(GL_EXTENSIONS, i));
     }
   }
   void run() {
     start();
     ui::Font::setup();
+    Loader::start();
     cObject.init();
 
-    int fps = 0;
-    int current_sec = 0;
-    int no_frames = 0;
+    FrameProfiler &profiler = cObject.profiler;
+    TRACE_THREAD("main");
     while(!glfwWindowShouldClose(window) && cObject.is_active()) {
-      int new_s = int(Timer::system_time());
-      if(new_s != current_sec) {
-        current_sec = new_s;
-        fps = no_frames;
-        //printf("fps=%d\n", fps);
-        no_frames = 1;
-      } else {
-        ++no_frames;
+      TRACE_SCOPE("frame");
+      Timer::update_frame_time();
+      profiler.begin_frame();
+      {
+        auto phase = profiler.scope(FrameProfiler::POLL);
+        glfwPollEvents(); GLERROR
+      }
+      {
+        auto phase = profiler.scope(FrameProfiler::UPLOAD);
+        Loader::upload(UPLOAD_BUDGET);
       }
-      glfwPollEvents(); GLERROR
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); GLERROR
       cObject.mouse(cursor_pos.x, cursor_pos.y);
       cObject.display(window, width(), height());
-      glfwSwapBuffers(window); GLERROR
+      gl::StreamBuffer::end_frame();
+      {
+        TRACE_SCOPE("swap buffers");
+        auto phase = profiler.scope(FrameProfiler::SWAP);
+        glfwSwapBuffers(window); GLERROR
+      }
+      profiler.end_frame();
     }
+    Loader::stop();
     cObject.clear();
+    asset::clear();
+    gl::StreamBuffer::clear();
     ui::Font::cleanup();
     glfwDestroyWindow(window); GLERROR
     glfwTerminate(); GLERROR
@@ -173,7 +191,7 @@ static Window &get_window(GLFWwindow *window) {
 namespace glfw {
 void error_callback(int error, const char* description) {
 /* #ifndef NDEBUG */
-  Logger::Error("[GLFW] code %i msg: %s\n", error, description);
+  LOG(ERROR, GRAPHICS, "[GLFW] code %i msg: %s\n", error, description);
 /* #endif */
 }
 void keypress_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include "Logger.hpp"
+#include "File.hpp"
+#include "ImageLoader.hpp"
+#include "Model.hpp"
+#include "AssetPack.hpp"
+
+// builds the asset pack minififa maps at startup:
+//
+//   assetpack <root> <output> <file>...
+//
+// files are relative to root and packed by their extension: shader sources
+// as they are, images decoded with their mip chains, models imported, packed
+// and reordered as the game would, with the images they use. the pack goes
+// next to the binary, as the assets and shaders directories do
+
+struct Blob {
+  std::string name;
+  AssetPack::Type type;
+  std::vector<uint8_t> data;
+
+  size_t append(const void *ptr, size_t size) {
+    // every part of a blob at an aligned offset
+    data.resize((data.size() + AssetPack::ALIGN - 1) / AssetPack::ALIGN * AssetPack::ALIGN);
+    const size_t offset = data.size();
+    data.insert(data.end(), (const uint8_t *)ptr, (const uint8_t *)ptr + size);
+    return offset;
+  }
+
+  template <typename T>
+  T &get(size_t offset) {
+    return *(T *)&data[offset];
+  }
+};
+
+void copy_name(char *dst, size_t size, const std::string &src) {
+  if(src.length() >= size) {
+    TERMINATE("assetpack: '%s' is longer than %lu characters\n", src.c_str(), size - 1);
+  }
+  memset(dst, 0, size);
+  memcpy(dst, src.c_str(), src.length());
+}
+
+Blob pack_shader(const std::string &root, const std::string &name) {
+  Blob b = {name, AssetPack::Type::SHADER, {}};
+  const std::string text = sys::File((sys::Path(root) / sys::Path(name)).str().c_str()).load_text();
+  b.append(text.data(), text.length());
+  return b;
+}
+
+// box filtered, each level half the size of the previous one down to 1x1
+Blob pack_image(const std::string &root, const std::string &name) {
+  Blob b = {name, AssetPack::Type::TEXTURE, {}};
+  sys::File file((sys::Path(root) / sys::Path(name)).str().c_str());
+  img::Image *image = img::load_image(file);
+  const size_t bpp = image->bpp();
+
+  AssetPack::TextureHeader header = {uint32_t(image->width), uint32_t(image->height), uint32_t(image->format), 0};
+  size_t w = image->width, h = image->height;
+  while(1) {
+    ++header.no_levels;
+    if(w == 1 && h == 1)break;
+    w = std::max<size_t>(w / 2, 1), h = std::max<size_t>(h / 2, 1);
+  }
+  b.append(&header, sizeof(header));
+  const size_t levels_offset = b.append(nullptr, 0);
+  b.data.resize(levels_offset + header.no_levels * sizeof(AssetPack::TextureLevel));
+
+  std::vector<uint8_t> level(image->data, image->data + image->width * image->height * bpp);
+  w = image->width, h = image->height;
+  for(uint32_t i = 0; i < header.no_levels; ++i) {
+    const size_t offset = b.append(level.data(), level.size());
+    b.get<AssetPack::TextureLevel>(levels_offset + i * sizeof(AssetPack::TextureLevel)) = {uint32_t(w), uint32_t(h), offset, level.size()};
+    if(i + 1 == header.no_levels)break;
+    const size_t nw = std::max<size_t>(w / 2, 1), nh = std::max<size_t>(h / 2, 1);
+    std::vector<uint8_t> next(nw * nh * bpp);
+    for(size_t y = 0; y < nh; ++y) {
+      for(size_t x = 0; x < nw; ++x) {
+        const size_t x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+        const size_t y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+        for(size_t c = 0; c < bpp; ++c) {
+          const unsigned sum = level[(y0 * w + x0) * bpp + c] + level[(y0 * w + x1) * bpp + c]
+                             + level[(y1 * w + x0) * bpp + c] + level[(y1 * w + x1) * bpp + c];
+          next[(y * nw + x) * bpp + c] = (sum + 2) / 4;
+        }
+      }
+    }
+    level.swap(next);
+    w = nw, h = nh;
+  }
+  delete image;
+  return b;
+}
+
+// the images of the model are added to textures, relative to root
+Blob pack_model(const std::string &root, const std::string &name, std::set<std::string> &textures) {
+  Blob b = {name, AssetPack::Type::MODEL, {}};
+  Model model((sys::Path(root) / sys::Path(name)).str());
+  model.load();
+  if(model.meshes.empty()) {
+    TERMINATE("assetpack: no meshes in '%s'\n", name.c_str());
+  }
+
+  AssetPack::ModelHeader header = {uint32_t(model.meshes.size()), 0, 0};
+  b.append(&header, sizeof(header));
+  const size_t meshes_offset = b.append(nullptr, 0);
+  b.data.resize(meshes_offset + model.meshes.size() * sizeof(AssetPack::MeshHeader));
+  b.get<AssetPack::ModelHeader>(0).meshes_offset = meshes_offset;
+
+  const std::string dir = sys::Path(name).dirname();
+  for(size_t i = 0; i < model.meshes.size(); ++i) {
+    const Mesh &m = model.meshes[i];
+    AssetPack::MeshHeader mh = {uint32_t(m.no_vertices), uint32_t(m.no_indices), 0, uint32_t(m.textures.size()), 0, 0, 0};
+    mh.vertices_offset = b.append(m.vertices.data(), m.vertices.size() * sizeof(PackedVertex));
+    if(m.index_type == GL_UNSIGNED_SHORT) {
+      const std::vector<uint16_t> short_indices(m.indices.begin(), m.indices.end());
+      mh.index_size = sizeof(uint16_t);
+      mh.indices_offset = b.append(short_indices.data(), short_indices.size() * sizeof(uint16_t));
+    } else {
+      mh.index_size = sizeof(GLuint);
+      mh.indices_offset = b.append(m.indices.data(), m.indices.size() * sizeof(GLuint));
+    }
+    std::vector<AssetPack::MeshTexture> mesh_textures(m.textures.size());
+    for(size_t j = 0; j < m.textures.size(); ++j) {
+      copy_name(mesh_textures[j].type, sizeof(mesh_textures[j].type), m.textures[j].type);
+      copy_name(mesh_textures[j].path, sizeof(mesh_textures[j].path), m.textures[j].texture_path);
+      textures.insert((sys::Path(dir) / sys::Path(m.textures[j].texture_path)).str());
+    }
+    mh.textures_offset = b.append(mesh_textures.data(), mesh_textures.size() * sizeof(AssetPack::MeshTexture));
+    b.get<AssetPack::MeshHeader>(meshes_offset + i * sizeof(AssetPack::MeshHeader)) = mh;
+  }
+  return b;
+}
+
+void write_pack(const std::string &output, std::vector<Blob> &blobs) {
+  std::sort(blobs.begin(), blobs.end(), [](const Blob &a, const Blob &b) -> bool {
+    return a.name < b.name;
+  });
+  std::vector<AssetPack::Entry> entries(blobs.size());
+  uint64_t offset = sizeof(AssetPack::Header);
+  for(size_t i = 0; i < blobs.size(); ++i) {
+    if(i > 0 && blobs[i].name == blobs[i - 1].name) {
+      TERMINATE("assetpack: '%s' is given twice\n", blobs[i].name.c_str());
+    }
+    offset = (offset + AssetPack::ALIGN - 1) / AssetPack::ALIGN * AssetPack::ALIGN;
+    copy_name(entries[i].name, sizeof(entries[i].name), blobs[i].name);
+    entries[i].type = blobs[i].type;
+    entries[i].reserved = 0;
+    entries[i].offset = offset;
+    entries[i].size = blobs[i].data.size();
+    offset += blobs[i].data.size();
+  }
+  offset = (offset + AssetPack::ALIGN - 1) / AssetPack::ALIGN * AssetPack::ALIGN;
+
+  AssetPack::Header header;
+  memcpy(header.magic, AssetPack::MAGIC, sizeof(header.magic));
+  header.version = AssetPack::VERSION;
+  header.no_entries = entries.size();
+  header.index_offset = offset;
+
+  FILE *file = fopen(output.c_str(), "wb");
+  if(file == nullptr) {
+    TERMINATE("assetpack: unable to open '%s' for writing\n", output.c_str());
+  }
+  const char zeros[AssetPack::ALIGN] = {0};
+  fwrite(&header, sizeof(header), 1, file);
+  for(size_t i = 0; i < blobs.size(); ++i) {
+    fwrite(zeros, 1, entries[i].offset - ftell(file), file);
+    fwrite(blobs[i].data.data(), 1, blobs[i].data.size(), file);
+  }
+  fwrite(zeros, 1, header.index_offset - ftell(file), file);
+  fwrite(entries.data(), sizeof(AssetPack::Entry), entries.size(), file);
+  LOG(INFO, GENERAL, "assetpack: wrote '%s', %lu entries, %ld bytes\n", output.c_str(), entries.size(), ftell(file));
+  fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+  if(argc < 4) {
+    fprintf(stderr, "usage: %s <root> <output> <file>...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  Logger::Setup();
+  Logger::MirrorLog(stdout);
+  const std::string root = argv[1], output = argv[2];
+  std::vector<Blob> blobs;
+  std::set<std::string> images;
+  for(int i = 3; i < argc; ++i) {
+    const std::string name = AssetPack::relative(root, argv[i]);
+    sys::File file(name.c_str());
+    if(file.is_ext(".vert") || file.is_ext(".frag") || file.is_ext(".geom")) {
+      blobs.push_back(pack_shader(root, name));
+      LOG(INFO, GENERAL, "assetpack: packed '%s'\n", name.c_str());
+    } else if(file.is_ext(".png") || file.is_ext(".jpg") || file.is_ext(".jpeg")
+              || file.is_ext(".tiff") || file.is_ext(".bmp") || file.is_ext(".tga"))
+    {
+      // after the models, which may use them too
+      images.insert(name);
+    } else if(file.is_ext(".3ds") || file.is_ext(".obj") || file.is_ext(".fbx")) {
+      blobs.push_back(pack_model(root, name, images));
+      LOG(INFO, GENERAL, "assetpack: packed '%s'\n", name.c_str());
+    } else {
+      TERMINATE("assetpack: don't know how to pack '%s'\n", name.c_str());
+    }
+  }
+  for(const auto &name : images) {
+    blobs.push_back(pack_image(root, name));
+    LOG(INFO, GENERAL, "assetpack: packed '%s'\n", name.c_str());
+  }
+  write_pack(output, blobs);
+  Logger::Close();
+}
@@ -5,6 +5,7 @@
 
 #include "Timer.hpp"
 #include "Button.hpp"
+#include "StreamBuffer.hpp"
 
 class ImageViewer {
   C_STRING(font_name, "assets/Verdana.ttf");
@@ -39,6 +40,7 @@ protected:
     window = glfwCreateWindow(width(), height(), "imageview", nullptr, nullptr);
     ASSERT(window != nullptr);
     glfwMakeContextCurrent(window); GLERROR
+    gl::State::reset();
   }
   void init_controls() {
     // ensure we can capture the escape key
@@ -64,10 +66,14 @@ public:
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); GLERROR
       button.label.set_text("text");
       button.display();
+      gl::StreamBuffer::end_frame();
       glfwPollEvents(); GLERROR
       glfwSwapBuffers(window); GLERROR
     }
     // display image
+    button.clear();
+    asset::clear();
+    gl::StreamBuffer::clear();
     ui::Font::cleanup();
     glfwDestroyWindow(window); GLERROR
     glfwTerminate(); GLERROR
@@ -6,6 +6,8 @@ int main(int argc ,char *argv[]) {
   Logger::MirrorLog(stderr);
   net::port_t port = (argc == 2) ? atoi(argv[1]) : 5678;
   MetaServer metaserver(port);
+  metaserver.socket.set_stats_output("metaserver.netstats.csv"s);
   metaserver.run();
+  TRACE_DUMP("metaserver.trace.json");
   Logger::Close();
 }
@@ -1,23 +1,43 @@
 #include "Client.hpp"
 #include "Window.hpp"
+#include "RenderBench.hpp"
 
 int main(int argc, char *argv[]) {
   std::string execdir = sys::get_executable_directory(argc, argv);
   Logger::Setup();
   Logger::SetLogOutput(sys::Path(execdir) / sys::Path("minififa.log"));
   Logger::MirrorLog(stdout);
-  Logger::Info("dir '%s'\n", execdir.c_str());
+  LOG(INFO, GENERAL, "dir '%s'\n", execdir.c_str());
   const std::string curdir = sys::get_current_dir();
-  Logger::Info("curdir '%s'\n", curdir.c_str());
-  Logger::Info("execdir '%s'\n", execdir.c_str());
+  LOG(INFO, GENERAL, "curdir '%s'\n", curdir.c_str());
+  LOG(INFO, GENERAL, "execdir '%s'\n", execdir.c_str());
+  AssetPack::open(execdir);
+  gl::ProgramCache::set_directory(sys::Path(execdir) / sys::Path("shadercache"s));
+  if(argc >= 2 && std::string(argv[1]) == "--bench") {
+    RenderBench::Options opts;
+    if(!RenderBench::parse_args(argc - 2, argv + 2, opts)) {
+      AssetPack::close();
+      Logger::Close();
+      return EXIT_FAILURE;
+    }
+    RenderBench bench(execdir, opts);
+    bench.run();
+    TRACE_DUMP("minififa.trace.json");
+    AssetPack::close();
+    Logger::Close();
+    return EXIT_SUCCESS;
+  }
   net::port_t port = (argc == 2) ? atoi(argv[1]) : 5679;
   std::set<net::Addr> metaservers;
   /* metaservers.insert(net::Addr(net::ipv4_from_ints(127, 0, 0, 1), net::port_t(5677))); */
   metaservers.insert(net::Addr(net::ipv4_from_ints(127, 0, 0, 1), net::port_t(5678)));
   Client client(metaservers, port);
+  client.mclient.socket.set_stats_output(sys::Path(execdir) / sys::Path("minififa.netstats.csv"));
   client.start();
   Window w(client, execdir);
   w.run();
   client.stop();
+  TRACE_DUMP("minififa.trace.json");
+  AssetPack::close();
   Logger::Close();
 }
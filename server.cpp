@@ -0,0 +1,133 @@
+#include <csignal>
+#include <unistd.h>
+
+#include <memory>
+
+#include "Lobby.hpp"
+
+volatile std::sig_atomic_t interrupted = 0;
+
+void usage(const char *prog) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  -p, --port PORT             port to listen on (5680)\n"
+    "  -m, --metaserver HOST:PORT  metaserver to register at, repeatable (127.0.0.1:5678)\n"
+    "  -n, --name NAME             game name shown in the server list (minififa)\n"
+    "  -P, --players N             start the game once N players have joined (2)\n"
+    "  -d, --duration SECONDS      end each game after SECONDS, 0 for never (0)\n"
+    "  -l, --lockstep              run the games in lockstep mode\n"
+    "  --sync-threshold ERROR      position error that triggers a unit sync\n"
+    "  --sync-keepalive SECONDS    maximum time between two syncs of a unit\n"
+    "  --log LEVELS                log levels, e.g. 'warning,lobby=debug'\n"
+    "  --stats FILE                network counters, appended every 5s (minififa-server.netstats.csv)\n",
+    prog);
+}
+
+int main(int argc, char *argv[]) {
+  Logger::Setup();
+  Logger::SetLogOutput("minififa-server.log"s);
+  Logger::MirrorLog(stderr);
+
+  net::port_t port = 5680;
+  std::set<net::Addr> metaservers;
+  std::string name = "minififa";
+  size_t no_players = 2;
+  Timer::time_t duration = 0.;
+  bool lockstep = false;
+  std::optional<Unit::real_t> sync_error_threshold;
+  std::optional<Timer::time_t> sync_keepalive;
+  std::string stats_output = "minififa-server.netstats.csv";
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if((arg == "-p" || arg == "--port") && has_value) {
+      port = atoi(argv[++i]);
+    } else if((arg == "-m" || arg == "--metaserver") && has_value) {
+      auto addr = net::resolve(argv[++i]);
+      if(!addr.has_value()) {
+        fprintf(stderr, "error: unable to resolve metaserver '%s'\n", argv[i]);
+        return EXIT_FAILURE;
+      }
+      metaservers.insert(addr.value());
+    } else if((arg == "-n" || arg == "--name") && has_value) {
+      name = argv[++i];
+    } else if((arg == "-P" || arg == "--players") && has_value) {
+      no_players = std::max(1, atoi(argv[++i]));
+    } else if((arg == "-d" || arg == "--duration") && has_value) {
+      duration = atof(argv[++i]);
+    } else if(arg == "-l" || arg == "--lockstep") {
+      lockstep = true;
+    } else if(arg == "--sync-threshold" && has_value) {
+      sync_error_threshold = atof(argv[++i]);
+    } else if(arg == "--sync-keepalive" && has_value) {
+      sync_keepalive = atof(argv[++i]);
+    } else if(arg == "--log" && has_value) {
+      if(!Logger::SetLevels(argv[++i])) {
+        fprintf(stderr, "error: invalid log levels '%s'\n", argv[i]);
+        return EXIT_FAILURE;
+      }
+    } else if(arg == "--stats" && has_value) {
+      stats_output = argv[++i];
+    } else {
+      usage(argv[0]);
+      return (arg == "-h" || arg == "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if(metaservers.empty()) {
+    metaservers.insert(net::Addr(net::ipv4_from_ints(127, 0, 0, 1), net::port_t(5678)));
+  }
+
+  std::signal(SIGINT, [](int) { interrupted = 1; });
+  std::signal(SIGTERM, [](int) { interrupted = 1; });
+
+  net::Socket<net::SocketType::UDP> socket(port);
+  socket.set_stats_output(stats_output);
+  std::recursive_mutex mservers_mtx;
+  LOG(INFO, GENERAL, "dedicated server: started at port %hu\n", socket.port());
+  while(!interrupted) {
+    // lobby: wait for the players
+    LobbyServer lserver(socket, metaservers, mservers_mtx);
+    lserver.dedicated = true;
+    lserver.announce_name = name;
+    lserver.lockstep = lockstep;
+    lserver.start();
+    while(!interrupted && lserver.lobby.size() < no_players) {
+      usleep(1e5);
+    }
+    if(interrupted) {
+      lserver.action_leave();
+      lserver.stop();
+      break;
+    }
+    LOG(INFO, GENERAL, "dedicated server: starting game with %lu players\n", lserver.lobby.size());
+    lserver.action_start();
+    Soccer soccer = lserver.get_soccer();
+    std::unique_ptr<Intelligence<IntelligenceType::ABSTRACT>> intelligence(lserver.make_intelligence(soccer));
+    lserver.stop();
+
+    // game: simulate at the display framerate of the clients
+    if(auto *server = dynamic_cast<SoccerServer *>(intelligence.get())) {
+      if(sync_error_threshold.has_value()) {
+        server->sync_error_threshold = sync_error_threshold.value();
+      }
+      if(sync_keepalive.has_value()) {
+        server->sync_keepalive = sync_keepalive.value();
+      }
+    }
+    intelligence->start();
+    const Timer::time_t game_start = Timer::system_time();
+    while(!interrupted && !intelligence->has_quit()) {
+      const Timer::time_t current_time = Timer::system_time() - game_start;
+      if(duration > 0. && current_time > duration) {
+        break;
+      }
+      intelligence->idle(current_time);
+      usleep(1e6 / 60);
+    }
+    intelligence->stop();
+    LOG(INFO, GENERAL, "dedicated server: game finished\n");
+  }
+  LOG(INFO, GENERAL, "dedicated server: finished\n");
+  TRACE_DUMP("minififa-server.trace.json");
+  Logger::Close();
+}
@@ -1,6 +1,10 @@
 #version 330 core
 
 uniform mat4 transform;
+layout (std140) uniform Frame {
+  mat4 camera;
+  float time;
+};
 
 layout (location = 0) in vec3 vpos;
 layout (location = 1) in vec2 vtex;
@@ -8,6 +12,6 @@ layout (location = 1) in vec2 vtex;
 out vec2 ftexcoords;
 
 void main() {
-  gl_Position = transform * vec4(vpos, 1.0);
+  gl_Position = camera * transform * vec4(vpos, 1.0);
   ftexcoords = vtex;
 }
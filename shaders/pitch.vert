@@ -1,12 +1,16 @@
 #version 330 core
 
 uniform mat4 transform;
+layout (std140) uniform Frame {
+  mat4 camera;
+  float time;
+};
 
 layout (location = 0) in vec2 vertex;
 
 out vec2 txcoords;
 
 void main(void) {
-  gl_Position = transform * vec4(vertex, 0, 1);
+  gl_Position = camera * transform * vec4(vertex, 0, 1);
   txcoords = (1 + vertex) / 2;
 }
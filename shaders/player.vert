@@ -3,12 +3,16 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceTransform;
 
 out vec2 TexCoords;
 
-uniform mat4 transform;
+layout (std140) uniform Frame {
+  mat4 camera;
+  float time;
+};
 
 void main() {
 	TexCoords = aTexCoords;
-	gl_Position = transform * vec4(aPos, 1.0);
+	gl_Position = camera * aInstanceTransform * vec4(aPos, 1.0);
 }
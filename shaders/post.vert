@@ -7,8 +7,12 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 
 uniform mat4 transform;
+layout (std140) uniform Frame {
+  mat4 camera;
+  float time;
+};
 
 void main() {
 	TexCoords = aTexCoords;
-	gl_Position = transform * vec4(aPos, 1.0);
+	gl_Position = camera * transform * vec4(aPos, 1.0);
 }
@@ -1,12 +1,16 @@
 #version 330 core
 
-uniform mat4 transform;
+layout (std140) uniform Frame {
+  mat4 camera;
+  float time;
+};
 
 layout (location = 0) in vec2 vertex;
+layout (location = 1) in mat4 instance_transform;
 
 out vec2 pos_xy;
 
 void main(void) {
-  gl_Position = transform * vec4(vertex, 0, 1);
+  gl_Position = camera * instance_transform * vec4(vertex, 0, 1);
   pos_xy = vertex;
 }
@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include "Timer.hpp"
+
+// the clock before it was made monotonic and lock-free, for comparison
+Timer::time_t locked_system_time() {
+  static std::mutex mtx;
+  static auto systime_start = std::chrono::system_clock::now();
+  std::lock_guard<std::mutex> guard(mtx);
+  auto systime_now = std::chrono::system_clock::now();
+  return 1e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(systime_now - systime_start).count();
+}
+
+volatile Timer::time_t sink = 0;
+
+// nanoseconds per call, with no_threads threads calling func at once
+template <typename F>
+double measure(int no_threads, size_t no_calls, F &&func) {
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < no_threads; ++i) {
+    threads.emplace_back([&]() mutable {
+      Timer::time_t sum = 0;
+      for(size_t j = 0; j < no_calls; ++j) {
+        sum += func();
+      }
+      sink = sum;
+    });
+  }
+  for(auto &t : threads) {
+    t.join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / no_calls;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t no_calls = (argc >= 2) ? atol(argv[1]) : 2000000;
+  const int max_threads = (argc >= 3) ? atoi(argv[2]) : std::max(4u, std::thread::hardware_concurrency());
+  Timer::update_frame_time();
+  printf("%8s %14s %14s %14s\n", "threads", "locked ns", "steady ns", "frame ns");
+  for(int no_threads = 1; no_threads <= max_threads; no_threads *= 2) {
+    const double locked = measure(no_threads, no_calls, locked_system_time);
+    const double steady = measure(no_threads, no_calls, Timer::system_time);
+    const double frame = measure(no_threads, no_calls, Timer::frame_time);
+    printf("%8d %14.2f %14.2f %14.2f\n", no_threads, locked, steady, frame);
+  }
+}